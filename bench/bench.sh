@@ -0,0 +1,77 @@
+#!/bin/sh
+# Copyright (c) 2015 Dell Inc.  All Rights Reserved
+#
+# This code is released under the GNU General Public license, version 2.
+#
+# Time biosdevname over synthetic systems of growing size, to show how
+# discovery and naming scale with the number of devices.
+#
+# usage: bench.sh [-r runs] [-k] [-p] biosdevname mkfixture [slots,ports,vfs ...]
+#   -p  also print the --profile phase breakdown for each size
+
+runs=3
+keep=
+profile=
+while getopts "r:kp" opt; do
+    case $opt in
+	r) runs=$OPTARG ;;
+	k) keep=1 ;;
+	p) profile=1 ;;
+	*) echo "usage: $0 [-r runs] [-k] [-p] biosdevname mkfixture [slots,ports,vfs ...]" >&2
+	   exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -lt 2 ]; then
+    echo "usage: $0 [-r runs] [-k] [-p] biosdevname mkfixture [slots,ports,vfs ...]" >&2
+    exit 1
+fi
+biosdevname=$1
+mkfixture=$2
+shift 2
+sizes=${*:-"1,2,0 4,2,0 16,4,0 16,4,8 32,4,16 64,4,16 64,8,16 128,4,32"}
+
+tmp=$(mktemp -d /tmp/biosdevname-bench.XXXXXX) || exit 1
+[ -z "$keep" ] && trap 'rm -rf "$tmp"' EXIT
+
+# wall time of the fastest run, in microseconds
+best_time()
+{
+    best=
+    i=0
+    while [ $i -lt $runs ]; do
+	start=$(date +%s%N)
+	"$@" > /dev/null || return 1
+	end=$(date +%s%N)
+	t=$(( (end - start) / 1000 ))
+	if [ -z "$best" ] || [ $t -lt $best ]; then
+	    best=$t
+	fi
+	i=$((i + 1))
+    done
+    echo $best
+}
+
+printf "%6s %6s %6s %8s %12s %10s\n" slots ports vfs netdevs wall_us syscalls
+for size in $sizes; do
+    IFS=, read slots ports vfs <<EOT
+$size
+EOT
+    dir=$tmp/$slots-$ports-$vfs
+    netdevs=$("$mkfixture" -s $slots -p $ports -v $vfs "$dir") || exit 1
+
+    us=$(best_time "$biosdevname" --root "$dir" -d) || {
+	echo "$biosdevname failed on $dir" >&2
+	exit 1
+    }
+
+    calls=-
+    if command -v strace > /dev/null 2>&1; then
+	strace -f -c -o "$dir.strace" "$biosdevname" --root "$dir" -d > /dev/null
+	calls=$(awk '$NF == "total" { print $4 }' "$dir.strace")
+    fi
+    printf "%6s %6s %6s %8s %12s %10s\n" $slots $ports $vfs $netdevs $us $calls
+    if [ -n "$profile" ]; then
+	"$biosdevname" --root "$dir" --profile -d 2>&1 > /dev/null | sed 's/^/    /'
+    fi
+done
@@ -0,0 +1,530 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Generate a synthetic system for "biosdevname --root": embedded ports
+ * plus N PCIe slots of M-port cards with K SR-IOV VFs per port, with
+ * SMBIOS type 9/41 records, Dell DCM VPD and one netdev per function.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+typedef unsigned char u8;
+
+struct fixture {
+	const char *dir;
+	int slots;
+	int ports;
+	int vfs;
+	int embedded;
+	int vpd;
+	int labels;
+	FILE *lspci;
+	FILE *netdev;
+	int ifindex;
+	u8 smbios[1 << 20];
+	int smbios_len;
+	int smbios_count;
+};
+
+static void die(const char *what)
+{
+	fprintf(stderr, "mkfixture: %s: %s\n", what, strerror(errno));
+	exit(1);
+}
+
+static void make_parents(const char *path)
+{
+	char buf[PATH_MAX];
+	char *c;
+
+	snprintf(buf, sizeof(buf), "%s", path);
+	for (c = buf+1; (c = strchr(c, '/')) != NULL; c++) {
+		*c = '\0';
+		if (mkdir(buf, 0755) && errno != EEXIST)
+			die(buf);
+		*c = '/';
+	}
+}
+
+/* f->dir/fmt into path, which has PATH_MAX bytes; too long is fatal */
+static void fixture_path(const struct fixture *f, char *path, const char *fmt, va_list ap)
+{
+	int len, n;
+
+	len = snprintf(path, PATH_MAX, "%s/", f->dir);
+	if (len < 0 || len >= PATH_MAX)
+		goto toolong;
+	n = vsnprintf(path + len, PATH_MAX - len, fmt, ap);
+	if (n < 0 || n >= PATH_MAX - len)
+		goto toolong;
+	return;
+toolong:
+	errno = ENAMETOOLONG;
+	die(f->dir);
+}
+
+static FILE *create(const struct fixture *f, const char *fmt, ...)
+{
+	char path[PATH_MAX];
+	va_list ap;
+	FILE *fp;
+
+	va_start(ap, fmt);
+	fixture_path(f, path, fmt, ap);
+	va_end(ap);
+	make_parents(path);
+	fp = fopen(path, "w");
+	if (!fp)
+		die(path);
+	return fp;
+}
+
+static void write_blob(const struct fixture *f, const char *name, const void *data, int len)
+{
+	FILE *fp = create(f, "%s", name);
+
+	if (fwrite(data, 1, len, fp) != len)
+		die(name);
+	fclose(fp);
+}
+
+static void write_attr(const struct fixture *f, const char *dir, const char *attr, const char *fmt, ...)
+{
+	va_list ap;
+	FILE *fp = create(f, "%s/%s", dir, attr);
+
+	va_start(ap, fmt);
+	vfprintf(fp, fmt, ap);
+	va_end(ap);
+	fclose(fp);
+}
+
+static void link_to(const struct fixture *f, const char *target, const char *fmt, ...)
+{
+	char path[PATH_MAX];
+	va_list ap;
+
+	va_start(ap, fmt);
+	fixture_path(f, path, fmt, ap);
+	va_end(ap);
+	make_parents(path);
+	unlink(path);
+	if (symlink(target, path))
+		die(path);
+}
+
+/* PCI functions */
+
+struct pcifn {
+	int bus, dev, fn;
+	int vendor, device, class;
+	int bridge, multifunction;
+	int sbus;		/* bridges only */
+	int exp_type;		/* PCIe port type, -1 for none */
+	int slot;		/* PCIe physical slot, 0 for none */
+	char sysdir[PATH_MAX];	/* relative to the fixture root */
+};
+
+#define PCI_NAME_FMT "0000:%02x:%02x.%d"
+
+static void add_pci(struct fixture *f, struct pcifn *p, const char *parent)
+{
+	u8 config[256];
+	char name[16], target[PATH_MAX];
+	int i;
+
+	snprintf(name, sizeof(name), PCI_NAME_FMT, p->bus, p->dev, p->fn);
+	snprintf(p->sysdir, sizeof(p->sysdir), "%s/%s", parent, name);
+	snprintf(target, sizeof(target), "../../..%s", p->sysdir + strlen("sys"));
+	link_to(f, target, "sys/bus/pci/devices/%s", name);
+	write_attr(f, p->sysdir, "class", "0x%06x\n", p->class << 8);
+
+	memset(config, 0, sizeof(config));
+	config[0x00] = p->vendor & 0xff;
+	config[0x01] = p->vendor >> 8;
+	config[0x02] = p->device & 0xff;
+	config[0x03] = p->device >> 8;
+	config[0x0a] = p->class & 0xff;
+	config[0x0b] = p->class >> 8;
+	config[0x0e] = (p->bridge ? 1 : 0) | (p->multifunction ? 0x80 : 0);
+	if (p->bridge) {
+		config[0x18] = p->bus;
+		config[0x19] = p->sbus;
+		config[0x1a] = p->sbus;
+	}
+	if (p->exp_type >= 0) {
+		config[0x06] = 0x10;		/* capability list */
+		config[0x34] = 0x40;
+		config[0x40] = 0x10;		/* PCI Express */
+		config[0x42] = 0x02 | (p->exp_type << 4);
+		if (p->slot) {
+			config[0x43] = 0x01;	/* slot implemented */
+			config[0x54 + 2] = (p->slot << 3) & 0xff;
+			config[0x54 + 3] = (p->slot >> 5) & 0xff;
+		}
+	}
+	fprintf(f->lspci, PCI_NAME_FMT " %04x: %04x:%04x\n",
+		p->bus, p->dev, p->fn, p->class, p->vendor, p->device);
+	for (i=0; i<sizeof(config); i++) {
+		if (i % 16 == 0)
+			fprintf(f->lspci, "%02x:", i);
+		fprintf(f->lspci, " %02x", config[i]);
+		if (i % 16 == 15)
+			fprintf(f->lspci, "\n");
+	}
+	fprintf(f->lspci, "\n");
+}
+
+/* Dell VPD-R with a DCM port map of every function on the card */
+static void add_vpd(struct fixture *f, const struct pcifn *p, int ports)
+{
+	u8 vpd[1024];
+	char dcm[256], path[PATH_MAX+8];
+	int len = 0, r, i, n;
+	const char *id = "Synthetic Network Adapter";
+	const char *ver = "DSV1028VPDR.VER1.0";
+
+	vpd[len++] = 0x82;
+	vpd[len++] = strlen(id);
+	vpd[len++] = 0;
+	memcpy(vpd+len, id, strlen(id));
+	len += strlen(id);
+
+	vpd[len++] = 0x90;
+	r = len;
+	len += 2;
+	vpd[len++] = 'V';
+	vpd[len++] = '0';
+	vpd[len++] = strlen(ver);
+	memcpy(vpd+len, ver, strlen(ver));
+	len += strlen(ver);
+
+	n = snprintf(dcm, sizeof(dcm), "DCM");
+	for (i=0; i<ports; i++)
+		n += snprintf(dcm+n, sizeof(dcm)-n, "%1x%1x%02x000000", i+1, i, 1);
+	vpd[len++] = 'V';
+	vpd[len++] = '1';
+	vpd[len++] = n;
+	memcpy(vpd+len, dcm, n);
+	len += n;
+	vpd[r] = (len - r - 2) & 0xff;
+	vpd[r+1] = (len - r - 2) >> 8;
+	vpd[len++] = 0x78;
+
+	snprintf(path, sizeof(path), "%s/vpd", p->sysdir);
+	write_blob(f, path, vpd, len);
+}
+
+static void add_netdev(struct fixture *f, const struct pcifn *p, const char *driver)
+{
+	char name[16], dir[PATH_MAX+32], target[32];
+	FILE *fp;
+	int index = f->ifindex++;
+
+	snprintf(name, sizeof(name), "eth%d", index - 2);
+	fprintf(f->netdev, "%6s: 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n", name);
+
+	fp = create(f, "sys/class/net/%s/uevent", name);
+	fprintf(fp, "INTERFACE=%s\nIFINDEX=%d\n", name, index);
+	fclose(fp);
+	snprintf(dir, sizeof(dir), "sys/class/net/%s", name);
+	write_attr(f, dir, "dev_port", "0\n");
+
+	/* sysfs links both ways between the interface and its function */
+	snprintf(target, sizeof(target), "../../..%s", strrchr(p->sysdir, '/'));
+	link_to(f, target, "sys/class/net/%s/device", name);
+	snprintf(dir, sizeof(dir), "%s/net/%s", p->sysdir, name);
+	write_attr(f, dir, "ifindex", "%d\n", index);
+
+	fp = create(f, "ethtool/%s", name);
+	fprintf(fp, "driver: %s\n", driver);
+	fprintf(fp, "version: 1.0\n");
+	fprintf(fp, "firmware-version: 1.0\n");
+	fprintf(fp, "bus-info: " PCI_NAME_FMT "\n", p->bus, p->dev, p->fn);
+	fprintf(fp, "ifindex: %d\n", index);
+	fprintf(fp, "type: 1\n");
+	fprintf(fp, "address: 02:%02x:%02x:%02x:%02x:%02x\n",
+		p->bus, p->dev, p->fn, (index >> 8) & 0xff, index & 0xff);
+	fprintf(fp, "permaddr: 02:%02x:%02x:%02x:%02x:%02x\n",
+		p->bus, p->dev, p->fn, (index >> 8) & 0xff, index & 0xff);
+	fclose(fp);
+}
+
+/* SMBIOS structures, terminated by their string set */
+static u8 *add_smbios(struct fixture *f, int type, int len, ...)
+{
+	u8 *h = f->smbios + f->smbios_len;
+	const char *str;
+	va_list ap;
+	int n;
+
+	if (f->smbios_len + len + 256 > sizeof(f->smbios)) {
+		fprintf(stderr, "mkfixture: SMBIOS table too large\n");
+		exit(1);
+	}
+	memset(h, 0, len);
+	h[0] = type;
+	h[1] = len;
+	h[2] = f->smbios_count & 0xff;
+	h[3] = f->smbios_count >> 8;
+	f->smbios_count++;
+	f->smbios_len += len;
+
+	va_start(ap, len);
+	n = 0;
+	while ((str = va_arg(ap, const char *)) != NULL) {
+		strcpy((char *)f->smbios + f->smbios_len, str);
+		f->smbios_len += strlen(str) + 1;
+		n++;
+	}
+	va_end(ap);
+	if (!n)
+		f->smbios[f->smbios_len++] = 0;
+	f->smbios[f->smbios_len++] = 0;
+	return h;
+}
+
+static u8 checksum(const u8 *buf, int len)
+{
+	u8 sum = 0;
+	int i;
+
+	for (i=0; i<len; i++)
+		sum += buf[i];
+	return -sum;
+}
+
+static void write_smbios(struct fixture *f)
+{
+	u8 ep[0x1f];
+
+	add_smbios(f, 127, 4, NULL);
+	if (f->smbios_len > 0xffff) {
+		fprintf(stderr, "mkfixture: SMBIOS table too large\n");
+		exit(1);
+	}
+
+	memset(ep, 0, sizeof(ep));
+	memcpy(ep, "_SM_", 4);
+	ep[0x05] = sizeof(ep);
+	ep[0x06] = 2;
+	ep[0x07] = 8;
+	ep[0x08] = 0xff;
+	memcpy(ep+0x10, "_DMI_", 5);
+	ep[0x16] = f->smbios_len & 0xff;
+	ep[0x17] = f->smbios_len >> 8;
+	ep[0x1c] = f->smbios_count & 0xff;
+	ep[0x1d] = f->smbios_count >> 8;
+	ep[0x1e] = 0x28;
+	ep[0x15] = checksum(ep+0x10, 0x0f);
+	ep[0x04] = checksum(ep, sizeof(ep));
+
+	write_blob(f, "sys/firmware/dmi/tables/smbios_entry_point", ep, sizeof(ep));
+	write_blob(f, "sys/firmware/dmi/tables/DMI", f->smbios, f->smbios_len);
+}
+
+static void add_embedded(struct fixture *f, const char *root)
+{
+	struct pcifn rp, ep;
+	char label[32];
+	u8 *h;
+	int i;
+
+	memset(&rp, 0, sizeof(rp));
+	rp.bus = 0; rp.dev = 1; rp.fn = 0;
+	rp.vendor = 0x8086; rp.device = 0x3c02; rp.class = 0x0604;
+	rp.bridge = 1; rp.sbus = 1; rp.exp_type = 4;
+	add_pci(f, &rp, root);
+
+	for (i=0; i<f->embedded; i++) {
+		memset(&ep, 0, sizeof(ep));
+		ep.bus = 1; ep.dev = 0; ep.fn = i;
+		ep.vendor = 0x14e4; ep.device = 0x165f; ep.class = 0x0200;
+		ep.multifunction = (i == 0 && f->embedded > 1);
+		ep.exp_type = 0;
+		add_pci(f, &ep, rp.sysdir);
+		snprintf(label, sizeof(label), "Embedded NIC %d", i+1);
+		if (f->labels) {
+			write_attr(f, ep.sysdir, "index", "%d\n", i+1);
+			write_attr(f, ep.sysdir, "label", "%s\n", label);
+		}
+		if (f->vpd)
+			add_vpd(f, &ep, f->embedded);
+		h = add_smbios(f, 41, 0x0b, label, NULL);
+		h[0x04] = 1;
+		h[0x05] = 0x85;		/* enabled, ethernet */
+		h[0x06] = i+1;
+		h[0x09] = ep.bus;
+		h[0x0a] = (ep.dev << 3) | ep.fn;
+		add_netdev(f, &ep, "tg3");
+	}
+}
+
+static void add_slot(struct fixture *f, const char *root, int slot)
+{
+	struct pcifn rp, pf[8], vf;
+	char label[32], name[16], target[32];
+	int i, j, rid, offset;
+	u8 *h;
+
+	memset(&rp, 0, sizeof(rp));
+	rp.bus = 0; rp.dev = 2 + (slot-1) / 8; rp.fn = (slot-1) % 8;
+	rp.vendor = 0x8086; rp.device = 0x3c04; rp.class = 0x0604;
+	rp.multifunction = (rp.fn == 0 && slot < f->slots);
+	rp.bridge = 1; rp.sbus = 1 + slot; rp.exp_type = 4; rp.slot = slot;
+	add_pci(f, &rp, root);
+
+	snprintf(label, sizeof(label), "PCIe Slot %d", slot);
+	h = add_smbios(f, 9, 0x11, label, NULL);
+	h[0x04] = 1;
+	h[0x05] = 0xb6;		/* PCI Express Gen 3 x8 */
+	h[0x06] = 0x0b;
+	h[0x07] = 0x04;		/* in use */
+	h[0x08] = 0x04;
+	h[0x09] = slot & 0xff;
+	h[0x0a] = slot >> 8;
+	h[0x0b] = 0x0c;
+	h[0x0c] = 0x01;
+	h[0x0f] = rp.bus;
+	h[0x10] = (rp.dev << 3) | rp.fn;
+
+	for (i=0; i<f->ports; i++) {
+		memset(&pf[i], 0, sizeof(pf[i]));
+		pf[i].bus = rp.sbus; pf[i].dev = 0; pf[i].fn = i;
+		pf[i].vendor = 0x8086; pf[i].device = 0x1572; pf[i].class = 0x0200;
+		pf[i].multifunction = (i == 0 && f->ports > 1);
+		pf[i].exp_type = 0;
+		add_pci(f, &pf[i], rp.sysdir);
+		if (f->vpd)
+			add_vpd(f, &pf[i], f->ports);
+		add_netdev(f, &pf[i], "i40e");
+	}
+
+	/* VFs of port i land at devfn 0x80 + i*vfs + j on the same bus */
+	for (i=0; i<f->ports && f->vfs; i++) {
+		offset = 0x80 + i*f->vfs - i;
+		write_attr(f, pf[i].sysdir, "sriov_numvfs", "%d\n", f->vfs);
+		write_attr(f, pf[i].sysdir, "sriov_offset", "%d\n", offset);
+		write_attr(f, pf[i].sysdir, "sriov_stride", "1\n");
+		for (j=0; j<f->vfs; j++) {
+			rid = i + offset + j;
+			memset(&vf, 0, sizeof(vf));
+			vf.bus = rp.sbus; vf.dev = rid >> 3; vf.fn = rid & 7;
+			vf.vendor = 0x8086; vf.device = 0x154c; vf.class = 0x0200;
+			vf.exp_type = 0;
+			add_pci(f, &vf, rp.sysdir);
+
+			snprintf(name, sizeof(name), PCI_NAME_FMT, pf[i].bus, pf[i].dev, pf[i].fn);
+			snprintf(target, sizeof(target), "../%s", name);
+			link_to(f, target, "%s/physfn", vf.sysdir);
+			snprintf(name, sizeof(name), PCI_NAME_FMT, vf.bus, vf.dev, vf.fn);
+			snprintf(target, sizeof(target), "../%s", name);
+			link_to(f, target, "%s/virtfn%d", pf[i].sysdir, j);
+			add_netdev(f, &vf, "iavf");
+		}
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage:  mkfixture [options] dir\n");
+	fprintf(stderr, " Options:\n");
+	fprintf(stderr, "   -s [n]    number of PCIe slots (default 4, max 240)\n");
+	fprintf(stderr, "   -p [n]    ports per slot card (default 2, max 8)\n");
+	fprintf(stderr, "   -v [n]    SR-IOV VFs per port (default 0)\n");
+	fprintf(stderr, "   -e [n]    embedded ports (default 2, max 8)\n");
+	fprintf(stderr, "   -l        add sysfs index/label attributes for embedded ports\n");
+	fprintf(stderr, "   -V        no Dell DCM VPD\n");
+	fprintf(stderr, " Replay with:  biosdevname --root dir -d\n");
+}
+
+static struct fixture fixture;
+
+int main(int argc, char *argv[])
+{
+	struct fixture *f = &fixture;
+	const char *root = "sys/devices/pci0000:00";
+	struct pcifn host;
+	char path[PATH_MAX];
+	u8 *h;
+	int c, i;
+
+	f->slots = 4;
+	f->ports = 2;
+	f->embedded = 2;
+	f->vpd = 1;
+	while ((c = getopt(argc, argv, "s:p:v:e:lV")) != -1) {
+		switch (c) {
+		case 's':
+			f->slots = atoi(optarg);
+			break;
+		case 'p':
+			f->ports = atoi(optarg);
+			break;
+		case 'v':
+			f->vfs = atoi(optarg);
+			break;
+		case 'e':
+			f->embedded = atoi(optarg);
+			break;
+		case 'l':
+			f->labels = 1;
+			break;
+		case 'V':
+			f->vpd = 0;
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	if (optind != argc-1 || f->slots < 0 || f->slots > 240 ||
+	    f->ports < 1 || f->ports > 8 || f->embedded < 0 || f->embedded > 8 ||
+	    f->vfs < 0 || f->ports * f->vfs > 128) {
+		usage();
+		exit(1);
+	}
+	f->dir = argv[optind];
+
+	f->lspci = create(f, "lspci.txt");
+	f->netdev = create(f, "proc/net/dev");
+	fprintf(f->netdev, "Inter-|   Receive                                                |  Transmit\n");
+	fprintf(f->netdev, " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n");
+	fprintf(f->netdev, "%6s: 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n", "lo");
+	f->ifindex = 2;
+
+	h = add_smbios(f, 0, 0x12, "Dell Inc.", "1.0.0", "01/01/2020", NULL);
+	h[0x04] = 1;
+	h[0x05] = 2;
+	h[0x08] = 3;
+	write_attr(f, "sys/devices/virtual/dmi/id", "sys_vendor", "Dell Inc.\n");
+	/* UEFI with sysfs SMBIOS tables, so /dev/mem is never needed */
+	snprintf(path, sizeof(path), "%s/sys/firmware/efi/", f->dir);
+	make_parents(path);
+
+	memset(&host, 0, sizeof(host));
+	host.vendor = 0x8086; host.device = 0x3c00; host.class = 0x0600;
+	host.exp_type = -1;
+	add_pci(f, &host, root);
+	if (f->embedded)
+		add_embedded(f, root);
+	for (i=1; i<=f->slots; i++)
+		add_slot(f, root, i);
+	write_smbios(f);
+
+	fclose(f->lspci);
+	fclose(f->netdev);
+	printf("%d\n", f->ifindex - 2);
+	return 0;
+}
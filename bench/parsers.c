@@ -0,0 +1,452 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Throughput and robustness drivers for the firmware table parsers:
+ * SMBIOS structure tables (dmi_decode_table, including the HP OEM
+ * records), PCI VPD (tag reading and VPD-R keyword search) and the
+ * Dell DCM port map.  Each input is a blob file; -g writes a set of
+ * pathological ones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "state.h"
+#include "pci.h"
+#include "vpd.h"
+#include "bios_device.h"
+#include "dmidecode/types.h"
+#include "dmidecode/dmidecode.h"
+
+struct blob {
+	u8 *data;
+	int len;
+};
+
+enum parser { SMBIOS, VPD, DCM };
+
+static struct libbiosdevname_state *state;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int load(const char *path, struct blob *b)
+{
+	FILE *fp;
+	struct stat st;
+
+	fp = fopen(path, "r");
+	if (!fp || fstat(fileno(fp), &st)) {
+		fprintf(stderr, "parsers: %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	b->len = st.st_size;
+	b->data = malloc(b->len + 1);
+	if (!b->data || fread(b->data, 1, b->len, fp) != b->len) {
+		fclose(fp);
+		return 1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+static void count_dcm(void *arg, int port, int devfn, int pfi)
+{
+	(*(int *)arg)++;
+}
+
+/* VPD is read from a file descriptor, as from sysfs */
+static int decode_vpd(FILE *fp)
+{
+	u8 vpdr[PCI_VPDR_MAX_LEN];
+	int len, n = 0;
+
+	rewind(fp);
+	len = pci_vpd_read_vpdr(fileno(fp), vpdr, sizeof(vpdr));
+	if (len < 0)
+		return 0;
+	if (pci_vpd_findtag(vpdr, len, "DSV1028VPDR.VER"))
+		pci_vpd_parse_dcm(vpdr, len, count_dcm, &n);
+	return n;
+}
+
+/* Returns the number of records decoded */
+static int decode(enum parser p, const struct blob *b, u8 *work, FILE *vpdfile)
+{
+	int n = 0;
+
+	switch (p) {
+	case SMBIOS:
+		/* dmi_string() rewrites unprintable characters in place */
+		memcpy(work, b->data, b->len);
+		return dmi_decode_table(work, b->len, 0, 0, state);
+	case VPD:
+		return decode_vpd(vpdfile);
+	case DCM:
+		return pci_vpd_parse_dcm(b->data, b->len, count_dcm, &n);
+	}
+	return 0;
+}
+
+static FILE *vpd_file(const struct blob *b)
+{
+	FILE *fp = tmpfile();
+
+	if (!fp || fwrite(b->data, 1, b->len, fp) != b->len) {
+		perror("tmpfile");
+		exit(1);
+	}
+	fflush(fp);
+	return fp;
+}
+
+/* Average ns per decode of b */
+static double run(enum parser p, const struct blob *b, int iterations, int *records)
+{
+	u8 *work = malloc(b->len + 1);
+	FILE *fp = NULL;
+	double start;
+	int i;
+
+	if (!work)
+		exit(1);
+	if (p == VPD)
+		fp = vpd_file(b);
+	*records = decode(p, b, work, fp);
+	start = now_ns();
+	for (i=0; i<iterations; i++)
+		decode(p, b, work, fp);
+	start = (now_ns() - start) / iterations;
+	if (fp)
+		fclose(fp);
+	free(work);
+	return start;
+}
+
+/* Random damage: byte flips, and sometimes a truncation */
+static int fuzz(enum parser p, const struct blob *b, int iterations)
+{
+	struct blob m;
+	unsigned int seed;
+	u8 *work;
+	FILE *fp = NULL;
+	int i, j, flips;
+
+	m.data = malloc(b->len + 1);
+	work = malloc(b->len + 1);
+	if (!m.data || !work)
+		exit(1);
+	for (i=0; i<iterations; i++) {
+		seed = i;
+		memcpy(m.data, b->data, b->len);
+		m.len = b->len;
+		flips = 1 + rand_r(&seed) % 8;
+		for (j=0; j<flips && m.len; j++)
+			m.data[rand_r(&seed) % m.len] = rand_r(&seed);
+		if (rand_r(&seed) % 4 == 0 && m.len)
+			m.len = rand_r(&seed) % m.len;
+		if (p == VPD)
+			fp = vpd_file(&m);
+		decode(p, &m, work, fp);
+		if (fp)
+			fclose(fp);
+		fp = NULL;
+	}
+	free(work);
+	free(m.data);
+	return iterations;
+}
+
+/* Pathological inputs */
+
+static void write_blob(const char *dir, const char *name, const u8 *data, int len)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "w");
+	if (!fp || fwrite(data, 1, len, fp) != len) {
+		fprintf(stderr, "parsers: %s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	fclose(fp);
+	printf("%s\n", path);
+}
+
+static int add_struct(u8 *buf, int off, int type, int len, const char *str)
+{
+	u8 *h = buf + off;
+
+	memset(h, 0, len);
+	h[0] = type;
+	h[1] = len;
+	h[2] = off & 0xff;
+	h[3] = off >> 8;
+	off += len;
+	if (str) {
+		if (len > 4)
+			h[4] = 1;
+		strcpy((char *)buf + off, str);
+		off += strlen(str) + 1;
+	} else
+		buf[off++] = 0;
+	buf[off++] = 0;
+	return off;
+}
+
+static void gen_smbios(const char *dir)
+{
+	static u8 buf[65536];
+	char label[32];
+	int off, i, slot;
+
+	/* a full-size table of nothing but type 9 slots */
+	off = add_struct(buf, 0, 0, 0x12, "Dell Inc.");
+	for (slot = 1; off + 0x11 + 32 < 0xfff0; slot++) {
+		snprintf(label, sizeof(label), "PCIe Slot %d", slot);
+		i = off;
+		off = add_struct(buf, off, 9, 0x11, label);
+		buf[i+0x09] = slot & 0xff;
+		buf[i+0x0a] = slot >> 8;
+		buf[i+0x0f] = slot & 0xff;
+		buf[i+0x10] = 0x08;
+	}
+	off = add_struct(buf, off, 127, 4, NULL);
+	write_blob(dir, "smbios-type9-huge.bin", buf, off);
+
+	/* HP NIC tables at the maximum record length */
+	off = add_struct(buf, 0, 0, 0x12, "HP");
+	while (off + 0xfc + 4 < 0xfff0) {
+		i = off;
+		off = add_struct(buf, off, 209, 0xfc, NULL);
+		for (slot = 4; slot + 8 <= 0xfc; slot += 8) {
+			buf[i+slot] = (slot / 8) << 3;
+			buf[i+slot+1] = 1 + (i & 0x7f);
+		}
+	}
+	off = add_struct(buf, off, 127, 4, NULL);
+	write_blob(dir, "smbios-hp209.bin", buf, off);
+
+	/* short type 41, then a record and strings running off the end */
+	off = add_struct(buf, 0, 0, 0x12, "Dell Inc.");
+	off = add_struct(buf, off, 41, 0x06, "Embedded NIC 1");
+	i = off;
+	off = add_struct(buf, off, 9, 0x11, "PCIe Slot 1");
+	buf[i+1] = 0xff;
+	memset(buf + off - 2, 'A', 64);
+	write_blob(dir, "smbios-truncated.bin", buf, off + 62);
+}
+
+static int vpd_keyword(u8 *buf, int off, const char *kw, const char *data, int len)
+{
+	buf[off++] = kw[0];
+	buf[off++] = kw[1];
+	buf[off++] = len;
+	memcpy(buf + off, data, len);
+	return off + len;
+}
+
+static int dcm_string(char *dcm, int entries, int step)
+{
+	int i, n = sprintf(dcm, step == 10 ? "DCM" : "DC2");
+
+	for (i=0; i<entries; i++)
+		n += sprintf(dcm + n, step == 10 ? "%1x%1x%02x000000" : "%1x%02x%02x000000",
+			     1 + i % 4, i % 8, 1 + i / 4);
+	return n;
+}
+
+static void gen_vpd(const char *dir)
+{
+	static u8 buf[PCI_VPDR_MAX_LEN + 64];
+	char dcm[300];
+	const char *id = "Synthetic Network Adapter";
+	const char *ver = "DSV1028VPDR.VER1.0";
+	int off, r, n;
+
+	/* VPD-R at its maximum length, DCM as long as a keyword can be */
+	off = 0;
+	buf[off++] = PCI_VPDI_TAG;
+	buf[off++] = strlen(id);
+	buf[off++] = 0;
+	memcpy(buf + off, id, strlen(id));
+	off += strlen(id);
+	buf[off++] = PCI_VPDR_TAG;
+	r = off;
+	off += 2;
+	off = vpd_keyword(buf, off, "V0", ver, strlen(ver));
+	n = dcm_string(dcm, 25, 10);
+	off = vpd_keyword(buf, off, "V1", dcm, n);
+	while (off - r - 2 + 3 + 8 <= PCI_VPDR_MAX_LEN - 1)
+		off = vpd_keyword(buf, off, "VX", "filler..", 8);
+	buf[r] = (off - r - 2) & 0xff;
+	buf[r+1] = (off - r - 2) >> 8;
+	buf[off++] = PCI_VPD_SRDT_END;
+	write_blob(dir, "vpd-max.bin", buf, off);
+
+	/* DCM keyword claiming more data than the VPD-R holds */
+	off = r + 2;
+	off = vpd_keyword(buf, off, "V0", ver, strlen(ver));
+	n = dcm_string(dcm, 3, 10);
+	off = vpd_keyword(buf, off, "V1", dcm, n);
+	buf[off - n - 1] = 0xff;
+	buf[r] = (off - r - 2) & 0xff;
+	buf[r+1] = (off - r - 2) >> 8;
+	write_blob(dir, "vpd-overlong.bin", buf, off);
+}
+
+static void gen_dcm(const char *dir)
+{
+	u8 buf[512];
+	char dcm[300];
+	int off, n;
+
+	/* entries cut off mid-way, with no NUL anywhere after them */
+	n = dcm_string(dcm, 4, 10);
+	off = vpd_keyword(buf, 0, "V1", dcm, n - 4);
+	write_blob(dir, "dcm-truncated.bin", buf, off);
+
+	n = dcm_string(dcm, 22, 11);
+	off = vpd_keyword(buf, 0, "V1", dcm, n);
+	write_blob(dir, "dcm-dc2.bin", buf, off);
+
+	/* the keyword length runs past the buffer */
+	n = dcm_string(dcm, 2, 10);
+	off = vpd_keyword(buf, 0, "V1", dcm, n);
+	buf[2] = 0xf0;
+	write_blob(dir, "dcm-overlong.bin", buf, off);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage:  parsers [options] smbios|vpd|dcm blob...\n");
+	fprintf(stderr, "        parsers -g dir\n");
+	fprintf(stderr, " Options:\n");
+	fprintf(stderr, "   -n [n]    decode each blob n times (default 1000)\n");
+	fprintf(stderr, "   -f [n]    also decode n randomly damaged copies of each blob\n");
+	fprintf(stderr, "   -c [x]    fail if a record costs more than x times as much in the\n");
+	fprintf(stderr, "             whole blob as in its first half\n");
+	fprintf(stderr, "   -r [dir]  decode SMBIOS against the PCI devices of a --root fixture\n");
+	fprintf(stderr, "   -g [dir]  write pathological blobs to dir\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct blob b, half;
+	enum parser p;
+	double ns, ns_half, growth, limit = 0;
+	int c, i, records, iterations = 1000, fuzzing = 0, rc = 0;
+	struct libbiosdevname_config config;
+	const char *gen = NULL;
+
+	memset(&config, 0, sizeof(config));
+	while ((c = getopt(argc, argv, "n:f:c:r:g:")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'f':
+			fuzzing = atoi(optarg);
+			break;
+		case 'c':
+			limit = atof(optarg);
+			break;
+		case 'r':
+			config.sysroot = optarg;
+			break;
+		case 'g':
+			gen = optarg;
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	if (gen) {
+		if (mkdir(gen, 0755) && errno != EEXIST) {
+			perror(gen);
+			exit(1);
+		}
+		gen_smbios(gen);
+		gen_vpd(gen);
+		gen_dcm(gen);
+		return 0;
+	}
+	if (optind >= argc-1 || iterations < 1) {
+		usage();
+		exit(1);
+	}
+	if (!strcmp(argv[optind], "smbios"))
+		p = SMBIOS;
+	else if (!strcmp(argv[optind], "vpd"))
+		p = VPD;
+	else if (!strcmp(argv[optind], "dcm"))
+		p = DCM;
+	else {
+		usage();
+		exit(1);
+	}
+
+	state = alloc_state(&config);
+	if (!state)
+		exit(1);
+	if (config.sysroot && get_pci_devices(state)) {
+		fprintf(stderr, "parsers: cannot read PCI devices from %s\n", config.sysroot);
+		exit(1);
+	}
+
+	printf("%-28s %8s %8s %12s %10s %8s %8s\n",
+	       "blob", "bytes", "records", "ns/decode", "ns/record", "ns/byte", "growth");
+	for (i=optind+1; i<argc; i++) {
+		if (load(argv[i], &b)) {
+			rc = 1;
+			continue;
+		}
+		ns = run(p, &b, iterations, &records);
+		half.data = b.data;
+		half.len = b.len / 2;
+		ns_half = run(p, &half, iterations, &c);
+		/*
+		 * Cost per record of the whole blob against its first half:
+		 * 1.0 is linear.  VPD and DCM cut in half no longer parse, but
+		 * those are bounded by the 1KB VPD-R limit anyway.
+		 */
+		growth = 0;
+		if (records && c && ns_half > 0)
+			growth = (ns / records) / (ns_half / c);
+		printf("%-28s %8d %8d %12.0f %10.1f %8.2f ",
+		       strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i],
+		       b.len, records, ns, records ? ns / records : 0.0,
+		       b.len ? ns / b.len : 0.0);
+		if (growth > 0)
+			printf("%8.2f\n", growth);
+		else
+			printf("%8s\n", "-");
+		if (limit > 0 && growth > limit) {
+			fprintf(stderr, "parsers: %s: cost per record grows %.2fx with size\n",
+				argv[i], growth);
+			rc = 1;
+		}
+		if (fuzzing)
+			printf("%-28s %d damaged copies decoded\n", "", fuzz(p, &b, fuzzing));
+		free(b.data);
+	}
+	cleanup_bios_devices(state);
+	return rc;
+}
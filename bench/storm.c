@@ -0,0 +1,227 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Reproduce what udev does at boot: run "biosdevname -i <name>" for
+ * every interface of a --root fixture at once, and report the latency
+ * distribution and CPU used by the whole storm.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+struct job {
+	char name[32];
+	pid_t pid;
+	struct timespec start;
+	double latency;		/* ms */
+	int status;
+};
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1000.0 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+static double tv_ms(const struct timeval *tv)
+{
+	return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+/* Interface names from the fixture's proc/net/dev, loopback excluded */
+static int read_interfaces(const char *root, struct job **jobs)
+{
+	char path[PATH_MAX], line[512], name[32];
+	struct job *j = NULL;
+	int n = 0, lineno = 0;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/proc/net/dev", root);
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "storm: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (lineno++ < 2 || sscanf(line, " %31[^:]:", name) != 1)
+			continue;
+		if (!strcmp(name, "lo"))
+			continue;
+		j = realloc(j, (n+1) * sizeof(*j));
+		if (!j) {
+			fclose(fp);
+			return -1;
+		}
+		memset(&j[n], 0, sizeof(j[n]));
+		strcpy(j[n].name, name);
+		n++;
+	}
+	fclose(fp);
+	*jobs = j;
+	return n;
+}
+
+static pid_t spawn(const char *prog, const char *root, struct job *j)
+{
+	pid_t pid;
+	int fd;
+
+	clock_gettime(CLOCK_MONOTONIC, &j->start);
+	pid = fork();
+	if (pid == 0) {
+		fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0) {
+			dup2(fd, 1);
+			close(fd);
+		}
+		execl(prog, prog, "--root", root, "-i", j->name, (char *)NULL);
+		_exit(127);
+	}
+	j->pid = pid;
+	return pid;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, int pct)
+{
+	int i = (n * pct + 99) / 100 - 1;
+
+	if (i < 0)
+		i = 0;
+	return sorted[i];
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage:  storm [options] biosdevname fixture-dir\n");
+	fprintf(stderr, " Options:\n");
+	fprintf(stderr, "   -j [n]    concurrent invocations (default: all interfaces at once)\n");
+	fprintf(stderr, "   -r [n]    repeat the storm n times (default 1)\n");
+	fprintf(stderr, "   -t [ms]   fail if the p99 latency exceeds ms\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct job *jobs = NULL;
+	struct timespec start, end, now;
+	struct rusage ru;
+	double *lat, p99, cpu = 0, wall = 0, limit = 0;
+	int c, i, n, total, running, next, done, failed = 0;
+	int parallel = 0, rounds = 1, round;
+	const char *prog, *root;
+	pid_t pid;
+	int status;
+
+	while ((c = getopt(argc, argv, "j:r:t:")) != -1) {
+		switch (c) {
+		case 'j':
+			parallel = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 't':
+			limit = atof(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	if (optind != argc-2 || rounds < 1) {
+		usage();
+		exit(1);
+	}
+	prog = argv[optind];
+	root = argv[optind+1];
+
+	n = read_interfaces(root, &jobs);
+	if (n <= 0) {
+		fprintf(stderr, "storm: no interfaces under %s\n", root);
+		exit(1);
+	}
+	if (parallel <= 0 || parallel > n)
+		parallel = n;
+	total = n * rounds;
+	lat = malloc(total * sizeof(*lat));
+	if (!lat)
+		exit(1);
+
+	for (round = 0; round < rounds; round++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		running = next = done = 0;
+		while (done < n) {
+			while (running < parallel && next < n) {
+				if (spawn(prog, root, &jobs[next]) < 0) {
+					perror("fork");
+					exit(1);
+				}
+				next++;
+				running++;
+			}
+			pid = wait4(-1, &status, 0, &ru);
+			if (pid < 0) {
+				perror("wait4");
+				exit(1);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			for (i=0; i<next; i++) {
+				if (jobs[i].pid == pid)
+					break;
+			}
+			if (i == next)
+				continue;
+			jobs[i].pid = 0;
+			jobs[i].latency = elapsed_ms(&jobs[i].start, &now);
+			jobs[i].status = status;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				if (failed++ < 10)
+					fprintf(stderr, "storm: %s exited with status %d\n",
+						jobs[i].name, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+			}
+			lat[round*n + done] = jobs[i].latency;
+			cpu += tv_ms(&ru.ru_utime) + tv_ms(&ru.ru_stime);
+			running--;
+			done++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		wall += elapsed_ms(&start, &end);
+	}
+
+	qsort(lat, total, sizeof(*lat), cmp_double);
+	p99 = percentile(lat, total, 99);
+	printf("interfaces: %d  concurrency: %d  rounds: %d  failed: %d\n",
+	       n, parallel, rounds, failed);
+	printf("latency ms: p50 %.2f  p99 %.2f  max %.2f\n",
+	       percentile(lat, total, 50), p99, lat[total-1]);
+	printf("wall ms per storm: %.2f  cpu ms total: %.2f  cpu ms per call: %.2f\n",
+	       wall / rounds, cpu, cpu / total);
+
+	free(lat);
+	free(jobs);
+	if (failed)
+		return 1;
+	if (limit > 0 && p99 > limit) {
+		fprintf(stderr, "storm: p99 latency %.2f ms is over the %.2f ms limit\n", p99, limit);
+		return 2;
+	}
+	return 0;
+}
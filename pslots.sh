@@ -5,6 +5,7 @@
 #
 # Display PCI slots for block and network devices
 # Display bay/ID for SSD devices
+# (biosdevname --slots lists the slots without the vendor tools)
 declare -A dcmap
 
 function dcm()
@@ -8,16 +8,25 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/types.h>
 
 #include "libbiosdevname.h"
 #include "bios_dev_name.h"
+#include "capture.h"
+#include "export.h"
+#include "generate.h"
+#include "slots.h"
+#include "profile.h"
+#include "trace.h"
+#include "uevent.h"
+#include "explain.h"
+#include "flight.h"
+#include "livenames.h"
+#include "sysfs.h"
+#include "vfcache.h"
 
 static struct bios_dev_name_opts opts;
-int nopirq;
-int smver_mjr;
-int smver_mnr;
-int is_valid_smbios = 0;
 
 static void usage(void)
 {
@@ -29,6 +38,17 @@ static void usage(void)
 	fprintf(stderr, "   -P        or --prefix [string]     string use for embedded NICs (default='em')\n");
 	fprintf(stderr, "   -s        or --smbios [x.y]	       Require SMBIOS x.y or greater\n");
 	fprintf(stderr, "   -x        or --nopirq	       Don't use $PIR table for slot numbers\n");
+	fprintf(stderr, "   -r        or --root [dir]          Read hardware inputs from a capture in dir\n");
+	fprintf(stderr, "   -c        or --capture [dir]       Save all hardware inputs to dir\n");
+	fprintf(stderr, "             --profile[=json]         Print time spent in each phase to stderr\n");
+	fprintf(stderr, "             --trace [file]           Write a Chrome trace of discovery to file\n");
+	fprintf(stderr, "             --explain [ethN]         Show where each part of ethN's name came from\n");
+	fprintf(stderr, "             --monitor                Follow hotplug events and print names as they change\n");
+	fprintf(stderr, "             --rename-all             Rename every interface to its BIOS name\n");
+	fprintf(stderr, "             --export                 With -i, print all attributes as udev KEY=value\n");
+	fprintf(stderr, "             --write-links [dir]      Write a systemd .link file for each name to dir\n");
+	fprintf(stderr, "             --write-rules [file]     Write udev rules that set every name to file\n");
+	fprintf(stderr, "             --slots                  List the slot of every network and block device\n");
 	fprintf(stderr, "   -v        or --version             Show biosdevname version\n");
 	fprintf(stderr, " Example:  biosdevname -i eth0\n");
 	fprintf(stderr, "  returns: em1\n");
@@ -64,11 +84,22 @@ parse_opts(int argc, char **argv)
 			{"prefix",      required_argument, 0, 'P'},
 			{"nopirq",	      no_argument, 0, 'x'},
 			{"smbios",	required_argument, 0, 's'},
+			{"root",	required_argument, 0, 'r'},
+			{"capture",	required_argument, 0, 'c'},
+			{"profile",	optional_argument, 0, 'F'},
+			{"trace",	required_argument, 0, 'T'},
+			{"explain",	required_argument, 0, 'E'},
+			{"monitor",	      no_argument, 0, 'M'},
+			{"rename-all",	      no_argument, 0, 'R'},
+			{"export",	      no_argument, 0, 'X'},
+			{"write-links",	required_argument, 0, 'W'},
+			{"write-rules",	required_argument, 0, 'U'},
+			{"slots",	      no_argument, 0, 'S'},
 			{"version",           no_argument, 0, 'v'},
 			{0, 0, 0, 0}
 		};
 		c = getopt_long(argc, argv,
-				"dip:P:xs:v",
+				"dip:P:xs:r:c:v",
 				long_options, &option_index);
 		if (c == -1)
 			break;
@@ -80,16 +111,58 @@ parse_opts(int argc, char **argv)
 			opts.interface = 1;
 			break;
 		case 'p':
-			opts.namingpolicy = set_policy(optarg);
+			opts.config.namingpolicy = set_policy(optarg);
 			break;
 		case 'P':
-			opts.prefix = optarg;
+			opts.config.prefix = optarg;
 			break;
 		case 's':
-			sscanf(optarg, "%u.%u", &smver_mjr, &smver_mnr);
+			sscanf(optarg, "%u.%u", &opts.config.smver_mjr, &opts.config.smver_mnr);
 			break;
 		case 'x':
-			nopirq = 1;
+			opts.config.nopirq = 1;
+			break;
+		case 'r':
+			opts.config.sysroot = optarg;
+			break;
+		case 'c':
+			opts.capture = optarg;
+			break;
+		case 'F':
+			opts.profile = 1;
+			profile_enabled = 1;
+			if (optarg && !strcmp(optarg, "json"))
+				opts.profile_json = 1;
+			else if (optarg) {
+				usage();
+				exit(1);
+			}
+			break;
+		case 'T':
+			opts.trace = optarg;
+			profile_enabled = 1;
+			break;
+		case 'E':
+			opts.explain = optarg;
+			profile_enabled = 1;
+			break;
+		case 'M':
+			opts.monitor = 1;
+			break;
+		case 'R':
+			opts.rename_all = 1;
+			break;
+		case 'X':
+			opts.export = 1;
+			break;
+		case 'W':
+			opts.write_links = optarg;
+			break;
+		case 'U':
+			opts.write_rules = optarg;
+			break;
+		case 'S':
+			opts.slots = 1;
 			break;
 		case 'v':
 			fprintf(stderr, "biosdevname version %s\n",  BIOSDEVNAME_VERSION);
@@ -106,8 +179,14 @@ parse_opts(int argc, char **argv)
 		opts.optind = optind;
 	}
 
-	if (opts.prefix == NULL)
-		opts.prefix = "em";
+	if (opts.config.prefix == NULL)
+		opts.config.prefix = "em";
+	if (opts.config.sysroot == NULL)
+		opts.config.sysroot = "";
+	if (strlen(opts.config.sysroot) > SYSROOT_MAX) {
+		fprintf(stderr, "Error: %s: %s\n", opts.config.sysroot, strerror(ENAMETOOLONG));
+		exit(1);
+	}
 }
 
 static u_int32_t
@@ -148,24 +227,170 @@ running_as_root(void)
 	return 1;
 }
 
+static void print_change(const char *kernel_name, const char *bios_name, void *arg)
+{
+	printf("%s %s\n", kernel_name, bios_name ? bios_name : "-");
+	fflush(stdout);
+}
+
+/* Print "old new" for each rename, in the order they were done */
+static int rename_all(void *cookie)
+{
+	int failed;
+
+	failed = rename_bios_devices(cookie, print_change, NULL);
+	if (failed < 0)
+		perror("rtnetlink socket");
+	return failed ? 1 : 0;
+}
+
+/*
+ * Print "kernel_name bios_name" each time a name changes, and "-" for
+ * the name when it goes away.  With --root the events are read from
+ * stdin as KEY=value lines, one blank line after each event.  Every
+ * name is also kept published in RUN_DIR/names for readers to map.
+ */
+static int monitor(void **cookie)
+{
+	char buf[16384];
+	ssize_t len;
+	int fd = -1, publish;
+
+	publish = !live_names_publish(*cookie);
+	if (!publish)
+		fprintf(stderr, "Not publishing names, another monitor already does\n");
+	if (!*opts.config.sysroot) {
+		fd = uevent_open();
+		if (fd < 0) {
+			perror("uevent socket");
+			return 1;
+		}
+	}
+	for (;;) {
+		if (fd < 0)
+			len = uevent_read_text(stdin, buf, sizeof(buf));
+		else
+			len = uevent_recv(fd, buf, sizeof(buf));
+		if (len < 0 && fd >= 0 && errno == ENOBUFS) {
+			fprintf(stderr, "uevents were lost, reading all devices again\n");
+			cleanup_bios_devices(*cookie);
+			*cookie = setup_bios_devices(&opts.config);
+			if (!*cookie)
+				break;
+			if (publish)
+				live_names_publish(*cookie);
+			continue;
+		}
+		if (len < 0)
+			break;
+		if (update_bios_devices(*cookie, buf, len, print_change, NULL) > 0 && publish)
+			live_names_publish(*cookie);
+	}
+	if (publish)
+		live_names_stop(&opts.config);
+	if (fd >= 0) {
+		close(fd);
+		return 1;
+	}
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
-	int i, rc=0;
-	char *name;
+	int i, rc=0, single, flight = FLIGHT_ALONE;
+	char *name, *cached = NULL;
 	void *cookie = NULL;
 
 	parse_opts(argc, argv);
 
-	if (!running_as_root())
-		exit(3);
-	if (running_in_virtual_machine())
-		exit(4);
-	cookie = setup_bios_devices(opts.namingpolicy, opts.prefix);
+	/* a capture can be replayed anywhere, by anyone */
+	if (!*opts.config.sysroot) {
+		if (!running_as_root())
+			exit(3);
+		if (running_in_virtual_machine())
+			exit(4);
+	}
+	if (opts.monitor && opts.config.namingpolicy != physical) {
+		fprintf(stderr, "Error: --monitor only follows the physical policy\n");
+		exit(1);
+	}
+	if (opts.trace && trace_open(opts.trace)) {
+		fprintf(stderr, "Error: cannot write trace to %s\n", opts.trace);
+		exit(1);
+	}
+	/* udev asks about one interface at a time; don't read them all */
+	single = opts.interface && opts.argc == 1 && !opts.capture &&
+		!opts.explain && !opts.debug && !opts.monitor && !opts.rename_all &&
+		!opts.export && !opts.write_links && !opts.write_rules && !opts.slots;
+	if (single) {
+		/* a running --monitor already knows every name */
+		if (!live_names_lookup(&opts.config, opts.argv[0], &cached))
+			flight = FLIGHT_HIT;
+		/* the rest of a VF burst is answered from its first VF */
+		else if ((cached = vf_cache_lookup(&opts.config, opts.argv[0])))
+			flight = FLIGHT_HIT;
+		/* and the rest of a udev storm by whoever got there first */
+		else
+			flight = flight_lookup(&opts.config, opts.argv[0], &cached);
+		if (flight == FLIGHT_LEAD_ALL)
+			cookie = setup_bios_devices(&opts.config);
+		else if (flight != FLIGHT_HIT)
+			cookie = setup_bios_device(&opts.config, opts.argv[0]);
+		flight_publish(cookie);
+	} else if (opts.export && opts.interface && opts.argc == 1)
+		/* the published names don't carry the other attributes */
+		cookie = setup_bios_device(&opts.config, opts.argv[0]);
+	else
+		cookie = setup_bios_devices(&opts.config);
+	trace_close();
+	if (opts.profile)
+		profile_print(stderr, opts.profile_json);
+	if (flight == FLIGHT_HIT) {
+		if (cached)
+			printf("%s\n", cached);
+		else
+			rc = 2;
+		free(cached);
+		goto out;
+	}
 	if (!cookie) {
 		rc = 1;
 		goto out;
 	}
 
+	if (opts.capture) {
+		rc = capture_inputs(cookie, opts.capture);
+		goto out_cleanup;
+	}
+
+	if (opts.explain) {
+		rc = explain_bios_device(cookie, opts.explain);
+		goto out_cleanup;
+	}
+
+	if (opts.monitor) {
+		rc = monitor(&cookie);
+		goto out_cleanup;
+	}
+
+	if (opts.rename_all) {
+		rc = rename_all(cookie);
+		goto out_cleanup;
+	}
+
+	if (opts.write_links || opts.write_rules) {
+		if (opts.write_links)
+			rc |= write_links(cookie, opts.write_links);
+		if (opts.write_rules)
+			rc |= write_rules(cookie, opts.write_rules);
+		goto out_cleanup;
+	}
+
+	if (opts.slots) {
+		rc = list_slots(cookie);
+		goto out_cleanup;
+	}
+
 	if (opts.debug) {
 		unparse_bios_devices(cookie);
 		rc = 0;
@@ -179,10 +404,18 @@ int main(int argc, char *argv[])
 		goto out_usage;
 	}
 
+	if (opts.export) {
+		for (i=0; i<opts.argc; i++)
+			rc |= export_bios_device(stdout, cookie, opts.argv[i]);
+		goto out_cleanup;
+	}
+
 	for (i=0; i<opts.argc; i++) {
 		name = kern_to_bios(cookie, opts.argv[i]);
 		if (name) {
 			printf("%s\n", name);
+			if (single)
+				vf_cache_publish(cookie, opts.argv[i]);
 		}
 		else
 			rc |= 2; /* one or more given devices weren't found */
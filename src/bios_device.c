@@ -6,12 +6,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 #include <pci/pci.h>
 #include <net/if.h>
 #include "list.h"
 #include "bios_device.h"
 #include "state.h"
 #include "libbiosdevname.h"
+#include "profile.h"
+#include "sysfs.h"
 
 void free_bios_devices(void *cookie)
 {
@@ -24,6 +27,8 @@ void free_bios_devices(void *cookie)
 		free(dev->bios_name);
 		free(dev);
 	}
+	hash_table_free(&state->bios_by_name);
+	hash_table_free(&state->bios_by_ifindex);
 }
 
 
@@ -59,6 +64,90 @@ void unparse_bios_devices(void *cookie)
 	}
 }
 
+static unsigned int hash_kernel_name(const char *name)
+{
+	return hash_strn(name, IFNAMSIZ);
+}
+
+/*
+ * Index the bios devices by kernel name and ifindex, so that repeated
+ * queries against the same state don't walk the whole list.  Built in
+ * list order, so the first match is the same one a list walk would find.
+ */
+static void hash_bios_devices(struct libbiosdevname_state *state)
+{
+	struct bios_device *dev;
+	unsigned int count = 0;
+
+	list_for_each_entry(dev, &state->bios_devices, node)
+		count++;
+	if (hash_table_init(&state->bios_by_name, count))
+		return;
+	if (hash_table_init(&state->bios_by_ifindex, count)) {
+		hash_table_free(&state->bios_by_name);
+		return;
+	}
+	list_for_each_entry(dev, &state->bios_devices, node)
+		hash_bios_device(state, dev);
+}
+
+/* Index one device; after setup it goes last among devices with the same key */
+void hash_bios_device(struct libbiosdevname_state *state, struct bios_device *dev)
+{
+	if (!dev->netdev)
+		return;
+	if (!state->bios_by_name.size) {
+		if (hash_table_init(&state->bios_by_name, 0))
+			return;
+		if (hash_table_init(&state->bios_by_ifindex, 0)) {
+			hash_table_free(&state->bios_by_name);
+			return;
+		}
+	}
+	list_add_tail(&dev->name_node,
+		      hash_bucket(&state->bios_by_name, hash_kernel_name(dev->netdev->kernel_name)));
+	list_add_tail(&dev->ifindex_node,
+		      hash_bucket(&state->bios_by_ifindex, hash_int(dev->netdev->ifindex)));
+}
+
+void unhash_bios_device(struct bios_device *dev)
+{
+	list_del_init(&dev->name_node);
+	list_del_init(&dev->ifindex_node);
+}
+
+struct bios_device * find_bios_device_by_name(const struct libbiosdevname_state *state,
+					      const char *name)
+{
+	struct bios_device *dev;
+	struct list_head *bucket;
+
+	if (!state->bios_by_name.size)
+		return NULL;
+	bucket = hash_bucket(&state->bios_by_name, hash_kernel_name(name));
+	list_for_each_entry(dev, bucket, name_node) {
+		if (!strcmp(dev->netdev->kernel_name, name))
+			return dev;
+	}
+	return NULL;
+}
+
+struct bios_device * find_bios_device_by_ifindex(const struct libbiosdevname_state *state,
+						 int ifindex)
+{
+	struct bios_device *dev;
+	struct list_head *bucket;
+
+	if (!state->bios_by_ifindex.size)
+		return NULL;
+	bucket = hash_bucket(&state->bios_by_ifindex, hash_int(ifindex));
+	list_for_each_entry(dev, bucket, ifindex_node) {
+		if (dev->netdev->ifindex == ifindex)
+			return dev;
+	}
+	return NULL;
+}
+
 void unparse_bios_device_by_name(void *cookie,
 				 const char *name)
 {
@@ -67,10 +156,101 @@ void unparse_bios_device_by_name(void *cookie,
 	struct bios_device *dev;
 	if (!state)
 		return;
-	list_for_each_entry(dev, &state->bios_devices, node) {
-		if (dev->netdev && !strcmp(dev->netdev->kernel_name, name))
-			unparse_bios_device(dev);
+	dev = find_bios_device_by_name(state, name);
+	if (dev)
+		unparse_bios_device(dev);
+}
+
+/* Point dev's record at what the state knows now; nothing is copied */
+static void fill_bios_device_info(struct bios_device *dev)
+{
+	struct libbiosdevname_device *info = &dev->info;
+	struct network_device *n = dev->netdev;
+	struct pci_device *p = dev->pcidev;
+
+	info->kernel_name = n ? n->kernel_name : NULL;
+	info->bios_name = dev->duplicate ? NULL : dev->bios_name;
+	info->bus_info = n && drvinfo_valid(n) ? n->drvinfo.bus_info : "";
+	info->driver = n && drvinfo_valid(n) ? n->drvinfo.driver : "";
+	info->perm_addr = n && !zero_mac(n->perm_addr) ? n->perm_addr : NULL;
+	info->dev_addr = n ? n->dev_addr : NULL;
+	info->ifindex = n ? n->ifindex : -1;
+	info->dev_port = n ? n->devid : -1;
+	info->flags = dev->duplicate ? BIOS_DEVICE_DUPLICATE : 0;
+	info->location_source = dev->location_source;
+	info->port_source = dev->port_source;
+	info->interface_source = dev->interface_source;
+	if (!p) {
+		info->pci_domain = info->pci_bus = info->pci_device = info->pci_function = -1;
+		info->slot = info->vf_index = -1;
+		info->slot_source = SLOT_SOURCE_NONE;
+		return;
 	}
+	info->pci_domain = pci_domain_nr(p->pci_dev);
+	info->pci_bus = p->pci_dev->bus;
+	info->pci_device = p->pci_dev->dev;
+	info->pci_function = p->pci_dev->func;
+	info->slot = p->physical_slot < PHYSICAL_SLOT_UNKNOWN ? p->physical_slot : -1;
+	info->slot_source = p->slot_source;
+	info->vf_index = p->is_sriov_virtual_function ? (int)p->vf_index : -1;
+	if (p->physical_slot == 0)
+		info->flags |= BIOS_DEVICE_EMBEDDED;
+	if (p->is_sriov_physical_function)
+		info->flags |= BIOS_DEVICE_SRIOV_PF;
+	if (p->is_sriov_virtual_function)
+		info->flags |= BIOS_DEVICE_SRIOV_VF;
+}
+
+/*
+ * Records are filled in whenever naming finishes, so that readers only
+ * ever read them and can share a state.
+ */
+void fill_bios_devices_info(struct libbiosdevname_state *state)
+{
+	struct bios_device *dev;
+
+	list_for_each_entry(dev, &state->bios_devices, node)
+		fill_bios_device_info(dev);
+}
+
+/*
+ * Walk every device of a state:
+ *	for (d = first_bios_device(s); d; d = next_bios_device(s, d))
+ */
+const struct libbiosdevname_device * first_bios_device(void *cookie)
+{
+	struct libbiosdevname_state *state = cookie;
+
+	if (!state || list_empty(&state->bios_devices))
+		return NULL;
+	return &list_entry(state->bios_devices.next, struct bios_device, node)->info;
+}
+
+const struct libbiosdevname_device * next_bios_device(void *cookie,
+			const struct libbiosdevname_device *prev)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct bios_device *dev;
+
+	if (!state || !prev)
+		return NULL;
+	dev = container_of(prev, struct bios_device, info);
+	if (list_is_last(&dev->node, &state->bios_devices))
+		return NULL;
+	return &list_entry(dev->node.next, struct bios_device, node)->info;
+}
+
+const struct libbiosdevname_device * get_bios_device(void *cookie, const char *devname)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct bios_device *dev;
+
+	if (!state)
+		return NULL;
+	dev = find_bios_device_by_name(state, devname);
+	if (!dev)
+		return NULL;
+	return &dev->info;
 }
 
 char * kern_to_bios(void *cookie,
@@ -80,14 +260,22 @@ char * kern_to_bios(void *cookie,
 	struct bios_device *dev;
 	if (!state)
 		return NULL;
-	list_for_each_entry(dev, &state->bios_devices, node) {
-		if (dev->netdev && !strcmp(dev->netdev->kernel_name, name)) {
-			if (dev->duplicate)
-				return NULL;
-			return dev->bios_name;
-		}
-	}
-	return NULL;
+	dev = find_bios_device_by_name(state, name);
+	if (!dev || dev->duplicate)
+		return NULL;
+	return dev->bios_name;
+}
+
+char * ifindex_to_bios(void *cookie, int ifindex)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct bios_device *dev;
+	if (!state)
+		return NULL;
+	dev = find_bios_device_by_ifindex(state, ifindex);
+	if (!dev || dev->duplicate)
+		return NULL;
+	return dev->bios_name;
 }
 
 void unparse_bios_device_list(void *cookie)
@@ -210,6 +398,7 @@ static void sort_device_list(struct libbiosdevname_state *state)
 	struct bios_device *dev, *tmp;
 	list_for_each_entry_safe(dev, tmp, &state->bios_devices, node) {
 		insertion_sort_devices(dev, &sorted_devices, sort_by_type);
+		profile_items(PROFILE_SORT, 1);
 	}
 	list_splice(&sorted_devices, &state->bios_devices);
 }
@@ -228,78 +417,208 @@ int ismultiport(const char *driver)
 	return 0;
 }
 
-static void match_pci_and_eth_devs(struct libbiosdevname_state *state)
+static struct bios_device *add_bios_device(struct libbiosdevname_state *state,
+					   struct pci_device *p, struct network_device *n)
 {
-	struct pci_device *p;
 	struct bios_device *b;
+
+	b = malloc(sizeof(*b));
+	if (!b)
+		return NULL;
+	memset(b, 0, sizeof(*b));
+	INIT_LIST_HEAD(&b->node);
+	INIT_LIST_HEAD(&b->name_node);
+	INIT_LIST_HEAD(&b->ifindex_node);
+	b->pcidev = p;
+	b->netdev = n;
+	b->port = NULL;
+	b->info.port = -1;
+	b->info.pfi = -1;
+	if (p) {
+		if (ismultiport(n->drvinfo.driver)) {
+			b->port = malloc(sizeof(struct pci_port));
+			if (b->port != NULL) {
+				b->port->port = n->devid+1;
+				b->port->pfi = p->is_sriov_virtual_function ?
+					p->vf_index : -1;
+			}
+		}
+		claim_netdev(b->netdev);
+	}
+	list_add(&b->node, &state->bios_devices);
+	profile_items(PROFILE_MATCH, 1);
+	return b;
+}
+
+int is_pci_eth(const struct network_device *n, const char *pci_name)
+{
+	//Accept only Ethernet devices, otherwise ignore.
+	if(!netdev_arphrd_type_is_eth(n))
+		return 0;
+	if (strncmp(n->drvinfo.bus_info, pci_name, sizeof(n->drvinfo.bus_info)))
+		return 0;
+	/* Ignore if devtype is fcoe */
+	if (netdev_devtype_is_fcoe(n))
+		return 0;
+	return netdev_is_eligible(n);
+}
+
+static int is_unknown_eth(struct network_device *n)
+{
+	if (netdev_is_claimed(n))
+		return 0;
+	if (!drvinfo_valid(n))
+		return 0;
+	if (!is_ethernet(n)) /* for virtual interfaces */
+		return 0;
+	/* Ignore if devtype is fcoe */
+	return !netdev_devtype_is_fcoe(n);
+}
+
+/*
+ * Match ether devices against one PCI function.  VFs are passed as a
+ * pci_vf, and only get a full pci_device once something matches.
+ */
+static void match_pci_dev_and_eths(struct libbiosdevname_state *state,
+				   struct pci_device *p, struct pci_vf *vf,
+				   const char *pci_name)
+{
 	struct network_device *n;
+
+	/* Loop through the ether devices with this bus_info to find match */
+	for_each_net_device_by_bus_info(n, state, pci_name) {
+		if (!is_pci_eth(n, pci_name))
+			continue;
+		if (!p && (p = pci_vf_device(state, vf)) == NULL)
+			return;
+		add_bios_device(state, p, n);
+	}
+}
+
+static int cmp_pci_addr(const struct pci_dev *a, const struct pci_dev *b)
+{
+	if (pci_domain_nr(a) != pci_domain_nr(b))
+		return pci_domain_nr(a) < pci_domain_nr(b) ? -1 : 1;
+	if (a->bus != b->bus)
+		return a->bus < b->bus ? -1 : 1;
+	if (a->dev != b->dev)
+		return a->dev < b->dev ? -1 : 1;
+	if (a->func != b->func)
+		return a->func < b->func ? -1 : 1;
+	return 0;
+}
+
+static int sort_vfs(const void *a, const void *b)
+{
+	return cmp_pci_addr((*(struct pci_vf * const *)a)->pci_dev,
+			    (*(struct pci_vf * const *)b)->pci_dev);
+}
+
+static void match_vf_and_eths(struct libbiosdevname_state *state, struct pci_vf *vf)
+{
 	char pci_name[40];
 
+	unparse_pci_name(pci_name, sizeof(pci_name), vf->pci_dev);
+	match_pci_dev_and_eths(state, NULL, vf, pci_name);
+}
+
+/*
+ * Match in PCI address order, VFs included, as sort_device_list() only
+ * orders by type and SMBIOS and leaves the rest as they come.  VFs
+ * aren't on state->pci_devices, so they are sorted apart and merged in.
+ */
+static void match_pci_and_eth_devs(struct libbiosdevname_state *state)
+{
+	struct pci_device *p;
+	struct pci_vf **vfs = NULL;
+	char pci_name[40];
+	unsigned int i, n = 0, next = 0;
+
 	list_for_each_entry(p, &state->pci_devices, node) {
-		if (!is_pci_network(p))
+		if (is_pci_network(p) && p->sriov)
+			n += p->sriov->num_vfs;
+	}
+	if (n && (vfs = malloc(n * sizeof(*vfs))) == NULL)
+		fprintf(stderr, "out of memory\n");
+	n = 0;
+	list_for_each_entry(p, &state->pci_devices, node) {
+		if (!vfs || !is_pci_network(p) || !p->sriov)
 			continue;
+		for (i=0; i<p->sriov->num_vfs; i++) {
+			if (p->sriov->vf[i].pci_dev)
+				vfs[n++] = &p->sriov->vf[i];
+		}
+	}
+	if (n)
+		qsort(vfs, n, sizeof(*vfs), sort_vfs);
 
-		/* Loop through all ether devices to find match */
+	list_for_each_entry(p, &state->pci_devices, node) {
+		if (!is_pci_network(p))
+			continue;
+		while (next < n && cmp_pci_addr(vfs[next]->pci_dev, p->pci_dev) < 0)
+			match_vf_and_eths(state, vfs[next++]);
 		unparse_pci_name(pci_name, sizeof(pci_name), p->pci_dev);
-		list_for_each_entry(n, &state->network_devices, node) {
-			//Accept only Ethernet devices, otherwise ignore.
-			if(!netdev_arphrd_type_is_eth(n))
-				continue;
-			if (strncmp(n->drvinfo.bus_info, pci_name, sizeof(n->drvinfo.bus_info)))
-				continue;
-			/* Ignore if devtype is fcoe */
-			if (netdev_devtype_is_fcoe(n))
-				continue;
-			if (!netdev_is_eligible(n))
-				continue;
-			b = malloc(sizeof(*b));
-			if (!b)
-				continue;
-			memset(b, 0, sizeof(*b));
-			INIT_LIST_HEAD(&b->node);
-			b->pcidev = p;
-			b->netdev = n;
-			b->port = NULL;
-			if (ismultiport(n->drvinfo.driver)) {
-				b->port = malloc(sizeof(struct pci_port));
-				if (b->port != NULL) {
-					b->port->port = n->devid+1;
-					b->port->pfi = p->is_sriov_virtual_function ?
-						p->vf_index : -1;
-				}
-			}
-			claim_netdev(b->netdev);
-			list_add(&b->node, &state->bios_devices);
-		}
+		match_pci_dev_and_eths(state, p, NULL, pci_name);
 	}
+	while (next < n)
+		match_vf_and_eths(state, vfs[next++]);
+	free(vfs);
 }
 
 static void match_unknown_eths(struct libbiosdevname_state *state)
 {
-	struct bios_device *b;
 	struct network_device *n;
 	list_for_each_entry(n, &state->network_devices, node)
 	{
-		if (netdev_is_claimed(n))
-			continue;
-		if (!drvinfo_valid(n))
-			continue;
-		if (!is_ethernet(n)) /* for virtual interfaces */
-			continue;
-		/* Ignore if devtype is fcoe */
-		if (netdev_devtype_is_fcoe(n))
-			continue;
-		b = malloc(sizeof(*b));
-		if (!b)
-			continue;
-		memset(b, 0, sizeof(*b));
-		INIT_LIST_HEAD(&b->node);
-		b->netdev = n;
-		b->port = NULL;
-		list_add(&b->node, &state->bios_devices);
+		if (is_unknown_eth(n))
+			add_bios_device(state, NULL, n);
+	}
+}
+
+/*
+ * Match an interface that appeared after setup the way match_all()
+ * would have, and put it where sort_device_list() would.
+ */
+struct bios_device * match_eth(struct libbiosdevname_state *state,
+			       struct network_device *n)
+{
+	struct bios_device *b = NULL;
+	struct pci_device *p;
+	struct pci_vf *vf;
+	char pci_name[40];
+
+	p = find_dev_by_pci_name(state, n->drvinfo.bus_info);
+	vf = p ? NULL : find_vf_by_pci_name(state, n->drvinfo.bus_info);
+	if (p && is_pci_network(p)) {
+		unparse_pci_name(pci_name, sizeof(pci_name), p->pci_dev);
+		if (is_pci_eth(n, pci_name))
+			b = add_bios_device(state, p, n);
+	} else if (vf && vf->pci_dev && is_pci_network(vf->pf)) {
+		unparse_pci_name(pci_name, sizeof(pci_name), vf->pci_dev);
+		if (is_pci_eth(n, pci_name) && (p = pci_vf_device(state, vf)) != NULL)
+			b = add_bios_device(state, p, n);
 	}
+	if (!b && is_unknown_eth(n))
+		b = add_bios_device(state, NULL, n);
+	if (!b)
+		return NULL;
+	list_del_init(&b->node);
+	insertion_sort_devices(b, &state->bios_devices, sort_by_type);
+	hash_bios_device(state, b);
+	return b;
 }
 
+void remove_bios_device(struct bios_device *dev)
+{
+	list_del(&dev->node);
+	list_del_init(&dev->name_node);
+	list_del_init(&dev->ifindex_node);
+	if (dev->pcidev)
+		unclaim_netdev(dev->netdev);
+	free(dev->port);
+	free(dev->bios_name);
+	free(dev);
+}
 
 static void match_all(struct libbiosdevname_state *state)
 {
@@ -307,18 +626,64 @@ static void match_all(struct libbiosdevname_state *state)
 	match_unknown_eths(state);
 }
 
-static struct libbiosdevname_state * alloc_state(void)
+/* A copy of config with the defaults filled in, sharing its strings */
+void config_defaults(struct libbiosdevname_config *to, const struct libbiosdevname_config *config)
+{
+	*to = *config;
+	if (!to->prefix)
+		to->prefix = "em";
+	if (!to->sysroot)
+		to->sysroot = "";
+}
+
+struct libbiosdevname_state * alloc_state(const struct libbiosdevname_config *config)
 {
 	struct libbiosdevname_state *state;
+
+	if (config->sysroot && strlen(config->sysroot) > SYSROOT_MAX) {
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
 	state = malloc(sizeof(*state));
 	if (!state)
 		return NULL;
+	config_defaults(&state->config, config);
+	state->config.prefix = strdup(state->config.prefix);
+	state->config.sysroot = strdup(state->config.sysroot);
+	if (!state->config.prefix || !state->config.sysroot) {
+		free((char *)state->config.prefix);
+		free((char *)state->config.sysroot);
+		free(state);
+		return NULL;
+	}
+	state->is_valid_smbios = 0;
+	state->smbios_decoded = 0;
+	state->is_dell = -1;
 	INIT_LIST_HEAD(&state->bios_devices);
+	state->bios_by_name.buckets = NULL;
+	state->bios_by_name.size = 0;
+	state->bios_by_ifindex.buckets = NULL;
+	state->bios_by_ifindex.size = 0;
 	INIT_LIST_HEAD(&state->pci_devices);
+	state->pci_by_addr.buckets = NULL;
+	state->pci_by_addr.size = 0;
+	state->vfs_by_addr.buckets = NULL;
+	state->vfs_by_addr.size = 0;
 	INIT_LIST_HEAD(&state->network_devices);
+	state->netdevs_by_bus_info.buckets = NULL;
+	state->netdevs_by_bus_info.size = 0;
+	state->netdevs_by_name.buckets = NULL;
+	state->netdevs_by_name.size = 0;
+	state->netdev_count = 0;
 	INIT_LIST_HEAD(&state->slots);
 	state->pacc = NULL;
-	state->pirq_table = NULL;
+	state->pci_dump = NULL;
+	state->pirq_map = NULL;
+	state->pirq_loaded = 0;
+	state->bios_area = NULL;
+	state->bios_area_scanned = 0;
+	state->rescan_domain = -1;
+	state->rescan_bus = -1;
 	return state;
 }
 
@@ -332,8 +697,13 @@ void cleanup_bios_devices(void *cookie)
 	free_pci_devices(state);
 	if (state->pacc)
 		pci_cleanup(state->pacc);
-	if (state->pirq_table)
-		pirq_free_table(state->pirq_table);
+	free(state->pci_dump);
+	if (state->pirq_map)
+		pirq_free_slot_map(state->pirq_map);
+	legacy_bios_free(state->bios_area);
+	free((char *)state->config.prefix);
+	free((char *)state->config.sysroot);
+	free(state);
 }
 
 static int duplicates(struct bios_device *a, struct bios_device *b)
@@ -351,22 +721,48 @@ static int duplicates(struct bios_device *a, struct bios_device *b)
 static void find_duplicates(struct libbiosdevname_state *state)
 {
 	struct bios_device *a = NULL, *b = NULL;
+	unsigned int compared = 0;
 	list_for_each_entry(a, &state->bios_devices, node) {
 		list_for_each_entry(b, &state->bios_devices, node) {
 			if (a == b)
 				continue;
+			compared++;
 			if (duplicates(a, b)) {
 				a->duplicate = 1;
 				b->duplicate = 1;
 			}
 		}
 	}
+	profile_items(PROFILE_DUPLICATES, compared);
 }
 
-void * setup_bios_devices(int namingpolicy, const char *prefix)
+static int name_bios_devices(struct libbiosdevname_state *state)
+{
+	int rc;
+
+	profile_begin(PROFILE_MATCH);
+	match_all(state);
+	profile_end(PROFILE_MATCH);
+	profile_begin(PROFILE_SORT);
+	sort_device_list(state);
+	hash_bios_devices(state);
+	profile_end(PROFILE_SORT);
+	profile_begin(PROFILE_NAMING);
+	rc = assign_bios_network_names(state, state->config.namingpolicy, state->config.prefix);
+	profile_end(PROFILE_NAMING);
+	if (rc)
+		return rc;
+	profile_begin(PROFILE_DUPLICATES);
+	find_duplicates(state);
+	profile_end(PROFILE_DUPLICATES);
+	fill_bios_devices_info(state);
+	return 0;
+}
+
+void * setup_bios_devices(const struct libbiosdevname_config *config)
 {
 	int rc=1;
-	struct libbiosdevname_state *state = alloc_state();
+	struct libbiosdevname_state *state = alloc_state(config);
 
 	if (!state)
 		return NULL;
@@ -375,17 +771,94 @@ void * setup_bios_devices(int namingpolicy, const char *prefix)
 	if (rc)
 		goto out;
 
+	profile_begin(PROFILE_ETHS);
 	get_eths(state);
-	match_all(state);
-	sort_device_list(state);
-	rc = assign_bios_network_names(state, namingpolicy, prefix);
+	profile_end(PROFILE_ETHS);
+	rc = name_bios_devices(state);
+	if (rc)
+		goto out;
+	return state;
+
+out:
+	cleanup_bios_devices(state);
+	return NULL;
+}
+
+/* Read the interfaces of every network function in a slot, VFs included */
+static void get_slot_eths(struct libbiosdevname_state *state, int slot)
+{
+	struct pci_device *p;
+	char pci_name[40];
+	unsigned int i;
+
+	list_for_each_entry(p, &state->pci_devices, node) {
+		if (!is_pci_network(p) || p->physical_slot != slot)
+			continue;
+		unparse_pci_name(pci_name, sizeof(pci_name), p->pci_dev);
+		get_pci_eths(state, pci_name);
+		if (!p->sriov)
+			continue;
+		for (i=0; i<p->sriov->num_vfs; i++) {
+			if (!p->sriov->vf[i].pci_dev)
+				continue;
+			unparse_pci_name(pci_name, sizeof(pci_name), p->sriov->vf[i].pci_dev);
+			get_pci_eths(state, pci_name);
+		}
+	}
+}
+
+/*
+ * Read only the interfaces that can share a name with devname: those in
+ * the same slot, or the other embedded NICs, and VPD only on the buses
+ * that can change its name.  The PCI scan and the slot of every network
+ * function stay machine-wide: slot numbers come from firmware tables
+ * rather than the topology, so functions sharing a slot need not sit
+ * under one bridge, and only a full walk finds them all.  Anything this
+ * can't answer exactly goes to setup_bios_devices().
+ */
+void * setup_bios_device(const struct libbiosdevname_config *config, const char *devname)
+{
+	int rc=1;
+	struct libbiosdevname_state *state;
+	struct network_device *n;
+	struct pci_device *p;
+	char pci_name[40];
+
+	/* ethN follows every interface, and a "p" prefix can mimic slot names */
+	if (config->namingpolicy != physical || (config->prefix && config->prefix[0] == 'p'))
+		return setup_bios_devices(config);
+
+	state = alloc_state(config);
+	if (!state)
+		return NULL;
+
+	profile_begin(PROFILE_ETHS);
+	n = get_eth(state, devname);
+	/* sysfs must agree with ethtool for its net directories to be trusted */
+	rc = !n || read_eth_pci_name(state->config.sysroot, devname, pci_name, sizeof(pci_name)) ||
+		strncmp(pci_name, n->drvinfo.bus_info, sizeof(n->drvinfo.bus_info));
+	profile_end(PROFILE_ETHS);
+	if (rc) {
+		cleanup_bios_devices(state);
+		return setup_bios_devices(config);
+	}
+
+	rc = get_pci_devices_for(state, pci_name);
+	if (rc)
+		goto out;
+
+	profile_begin(PROFILE_ETHS);
+	p = find_slot_dev_by_pci_name(state, pci_name);
+	if (p && is_pci_network(p) && p->physical_slot < PHYSICAL_SLOT_UNKNOWN)
+		get_slot_eths(state, p->physical_slot);
+	hash_eths(state);
+	profile_end(PROFILE_ETHS);
+	rc = name_bios_devices(state);
 	if (rc)
 		goto out;
-	find_duplicates(state);
 	return state;
 
 out:
 	cleanup_bios_devices(state);
-	free(state);
 	return NULL;
 }
@@ -16,11 +16,17 @@ struct pci_port;
 
 struct bios_device {
 	struct list_head node;
+	struct list_head name_node;	/* in state->bios_by_name */
+	struct list_head ifindex_node;	/* in state->bios_by_ifindex */
 	struct network_device *netdev;
 	struct pci_device *pcidev;
 	char *bios_name;
 	struct pci_port *port;
 	int duplicate;
+	int location_source;	/* NAME_SOURCE_* for each part of bios_name */
+	int port_source;
+	int interface_source;
+	struct libbiosdevname_device info;	/* port and pfi set by naming */
 };
 
 static inline int is_pci(const struct bios_device *dev)
@@ -28,4 +34,20 @@ static inline int is_pci(const struct bios_device *dev)
 	return dev->pcidev != NULL;
 }
 
+extern void config_defaults(struct libbiosdevname_config *to,
+			    const struct libbiosdevname_config *config);
+extern struct libbiosdevname_state * alloc_state(const struct libbiosdevname_config *config);
+extern struct bios_device * find_bios_device_by_name(const struct libbiosdevname_state *state,
+						     const char *name);
+extern struct bios_device * find_bios_device_by_ifindex(const struct libbiosdevname_state *state,
+							int ifindex);
+extern void hash_bios_device(struct libbiosdevname_state *state, struct bios_device *dev);
+extern void unhash_bios_device(struct bios_device *dev);
+extern struct bios_device * match_eth(struct libbiosdevname_state *state,
+				      struct network_device *n);
+extern void remove_bios_device(struct bios_device *dev);
+extern void fill_bios_devices_info(struct libbiosdevname_state *state);
+extern int is_pci_eth(const struct network_device *n, const char *pci_name);
+extern int ismultiport(const char *driver);
+
 #endif /* BIOS_DEVICE_H_INCLUDED */
@@ -0,0 +1,405 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pci/pci.h>
+#include "state.h"
+#include "pci.h"
+#include "eths.h"
+#include "sysfs.h"
+#include "capture.h"
+#include "legacy_bios.h"
+#include "dmidecode/types.h"
+#include "dmidecode/util.h"
+#include "dmidecode/dmidecode.h"
+
+/*
+ * A capture directory mirrors the pieces of /sys, /proc and /dev/mem
+ * that biosdevname reads, plus the config space dump and socket ioctl
+ * results, so "biosdevname --root DIR" gives the same answers as the
+ * machine it was taken on.
+ */
+
+static const char *pci_attrs[] = {
+	"class",
+	"index",
+	"label",
+	"sriov_numvfs",
+	"sriov_offset",
+	"sriov_stride",
+};
+
+static const char *net_attrs[] = {
+	"phys_port_name",
+	"dev_port",
+	"dev_id",
+	"uevent",
+};
+
+/* mkdir -p of everything up to the last component of path */
+static int make_parents(const char *path)
+{
+	char buf[PATH_MAX];
+	char *c;
+
+	snprintf(buf, sizeof(buf), "%s", path);
+	for (c = buf+1; (c = strchr(c, '/')) != NULL; c++) {
+		*c = '\0';
+		if (mkdir(buf, 0755) && errno != EEXIST)
+			return 1;
+		*c = '/';
+	}
+	return 0;
+}
+
+/* Missing source files are fine, most attributes are optional */
+static int copy_file(const char *src, const char *dst)
+{
+	char buf[4096];
+	ssize_t len;
+	int in, out, rc = 0;
+
+	in = open(src, O_RDONLY);
+	if (in < 0)
+		return 0;
+	if (make_parents(dst) ||
+	    (out = open(dst, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0) {
+		close(in);
+		return 1;
+	}
+	while ((len = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, len) != len) {
+			rc = 1;
+			break;
+		}
+	}
+	close(in);
+	close(out);
+	return rc;
+}
+
+static int copy_link(const char *src, const char *dst)
+{
+	char target[PATH_MAX];
+	ssize_t len;
+
+	len = readlink(src, target, sizeof(target)-1);
+	if (len < 0)
+		return 0;
+	target[len] = '\0';
+	if (make_parents(dst))
+		return 1;
+	unlink(dst);
+	return symlink(target, dst);
+}
+
+static int capture_pci_sysfs_dev(const char *sysroot, const char *dir, const char *name)
+{
+	char src[PATH_MAX], dst[PATH_MAX], devdir[PATH_MAX], real[PATH_MAX];
+	char *class = NULL;
+	struct dirent *dent;
+	DIR *d;
+	int i, rc = 0;
+
+	/* keep the bus/pci/devices symlink so find_parent() sees the hierarchy */
+	if (sysfs_path(src, sizeof(src), "%s/sys/bus/pci/devices/%s", sysroot, name) ||
+	    sysfs_path(dst, sizeof(dst), "%s/sys/bus/pci/devices/%s", dir, name))
+		return 1;
+	rc |= copy_link(src, dst);
+	if (!realpath(src, real) ||
+	    sysfs_path(devdir, sizeof(devdir), "%s%s", dir, real + strlen(sysroot)))
+		return 1;
+
+	for (i=0; i<sizeof(pci_attrs)/sizeof(pci_attrs[0]); i++) {
+		if (sysfs_path(src, sizeof(src), "%s/%s", real, pci_attrs[i]) ||
+		    sysfs_path(dst, sizeof(dst), "%s/%s", devdir, pci_attrs[i])) {
+			rc = 1;
+			continue;
+		}
+		rc |= copy_file(src, dst);
+	}
+
+	/* VPD is only read from network devices, and can be slow */
+	if (!sysfs_path(src, sizeof(src), "%s/class", real) &&
+	    sysfs_read_file(src, &class) == 0) {
+		if (!strncmp(class, "0x02", 4)) {
+			if (sysfs_path(src, sizeof(src), "%s/vpd", real) ||
+			    sysfs_path(dst, sizeof(dst), "%s/vpd", devdir))
+				rc = 1;
+			else
+				rc |= copy_file(src, dst);
+		}
+		free(class);
+	}
+
+	/* the interfaces bound to this function, for single-interface lookups */
+	d = NULL;
+	if (!sysfs_path(src, sizeof(src), "%s/net", real))
+		d = opendir(src);
+	if (d) {
+		while ((dent = readdir(d)) != NULL) {
+			if (dent->d_name[0] == '.')
+				continue;
+			if (sysfs_path(dst, sizeof(dst), "%s/net/%s/", devdir, dent->d_name))
+				rc = 1;
+			else
+				rc |= make_parents(dst);
+		}
+		closedir(d);
+	}
+
+	d = opendir(real);
+	if (!d)
+		return rc;
+	while ((dent = readdir(d)) != NULL) {
+		if (strcmp(dent->d_name, "physfn") &&
+		    strncmp(dent->d_name, "virtfn", 6))
+			continue;
+		if (sysfs_path(src, sizeof(src), "%s/%s", real, dent->d_name) ||
+		    sysfs_path(dst, sizeof(dst), "%s/%s", devdir, dent->d_name)) {
+			rc = 1;
+			continue;
+		}
+		rc |= copy_link(src, dst);
+	}
+	closedir(d);
+	return rc;
+}
+
+static int capture_pci_sysfs(const char *sysroot, const char *dir)
+{
+	char path[PATH_MAX];
+	struct dirent *dent;
+	DIR *d;
+	int rc = 0;
+
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices", sysroot);
+	d = opendir(path);
+	if (!d)
+		return 1;
+	while ((dent = readdir(d)) != NULL) {
+		if (dent->d_name[0] == '.')
+			continue;
+		rc |= capture_pci_sysfs_dev(sysroot, dir, dent->d_name);
+	}
+	closedir(d);
+	return rc;
+}
+
+/* Same layout as lspci -xxxx, which is what libpci's dump method reads */
+static int capture_pci_config(const char *dir, struct pci_access *pacc)
+{
+	char path[PATH_MAX];
+	u8 config[4096];
+	struct pci_dev *p;
+	FILE *fp;
+	int i, len;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, PCI_DUMP_FILE);
+	fp = fopen(path, "w");
+	if (!fp)
+		return 1;
+	for (p=pacc->devices; p; p=p->next) {
+		len = sizeof(config);
+		if (!pci_read_block(p, 0, config, len)) {
+			len = 256;
+			if (!pci_read_block(p, 0, config, len))
+				continue;
+		}
+		fprintf(fp, "%04x:%02x:%02x.%d %04x: %04x:%04x\n",
+			pci_domain_nr(p), p->bus, p->dev, p->func,
+			config[PCI_CLASS_DEVICE] | (config[PCI_CLASS_DEVICE+1] << 8),
+			WORD(config), WORD(config+2));
+		for (i=0; i<len; i++) {
+			if (i % 16 == 0)
+				fprintf(fp, i < 256 ? "%02x:" : "%03x:", i);
+			fprintf(fp, " %02x", config[i]);
+			if (i % 16 == 15)
+				fprintf(fp, "\n");
+		}
+		fprintf(fp, "\n");
+	}
+	i = ferror(fp);
+	return fclose(fp) || i;
+}
+
+static int capture_net(const char *dir, struct libbiosdevname_state *state)
+{
+	char src[PATH_MAX], dst[PATH_MAX];
+	struct network_device *n;
+	const char *sysroot = state->config.sysroot;
+	FILE *fp;
+	int i, rc = 0;
+
+	snprintf(src, sizeof(src), "%s/proc/net/dev", sysroot);
+	snprintf(dst, sizeof(dst), "%s/proc/net/dev", dir);
+	rc |= copy_file(src, dst);
+
+	list_for_each_entry(n, &state->network_devices, node) {
+		for (i=0; i<sizeof(net_attrs)/sizeof(net_attrs[0]); i++) {
+			snprintf(src, sizeof(src), "%s/sys/class/net/%s/%s", sysroot, n->kernel_name, net_attrs[i]);
+			snprintf(dst, sizeof(dst), "%s/sys/class/net/%s/%s", dir, n->kernel_name, net_attrs[i]);
+			rc |= copy_file(src, dst);
+		}
+		snprintf(src, sizeof(src), "%s/sys/class/net/%s/device", sysroot, n->kernel_name);
+		snprintf(dst, sizeof(dst), "%s/sys/class/net/%s/device", dir, n->kernel_name);
+		rc |= copy_link(src, dst);
+		snprintf(dst, sizeof(dst), "%s/%s/%s", dir, ETHTOOL_DUMP_DIR, n->kernel_name);
+		if (make_parents(dst) || (fp = fopen(dst, "w")) == NULL) {
+			rc = 1;
+			continue;
+		}
+		rc |= save_eth_dev(fp, n);
+		rc |= fclose(fp);
+	}
+	return rc;
+}
+
+static int capture_mem(int fd, size_t base, size_t len, const u8 *data)
+{
+	return pwrite(fd, data, len, base) != len;
+}
+
+static int capture_mem_chunk(const char *sysroot, int fd, size_t base, size_t len)
+{
+	char devmem[PATH_MAX];
+	u8 *buf;
+	int rc;
+
+	snprintf(devmem, sizeof(devmem), "%s/dev/mem", sysroot);
+	buf = mem_chunk(base, len, devmem);
+	if (!buf)
+		return 1;
+	rc = capture_mem(fd, base, len, buf);
+	free(buf);
+	return rc;
+}
+
+/* Copy the structure table an _SM_ or _DMI_ entry point refers to */
+static int capture_smbios_table(const char *sysroot, int fd, const u8 *ep)
+{
+	if (!memcmp(ep, "_SM_", 4))
+		ep += 0x10;
+	if (memcmp(ep, "_DMI_", 5))
+		return 0;
+	return capture_mem_chunk(sysroot, fd, DWORD(ep+0x08), WORD(ep+0x06));
+}
+
+static int capture_efi_smbios(const char *sysroot, int fd)
+{
+	char path[PATH_MAX], line[64];
+	unsigned long address = 0;
+	u8 *ep;
+	FILE *fp;
+	int rc;
+
+	snprintf(path, sizeof(path), "%s/sys/firmware/efi/systab", sysroot);
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (sscanf(line, "SMBIOS=%lx", &address) == 1)
+			break;
+	}
+	fclose(fp);
+	if (!address)
+		return 0;
+
+	snprintf(path, sizeof(path), "%s/dev/mem", sysroot);
+	ep = mem_chunk(address, 0x20, path);
+	if (!ep)
+		return 1;
+	rc = capture_mem(fd, address, 0x20, ep);
+	rc |= capture_smbios_table(sysroot, fd, ep);
+	free(ep);
+	return rc;
+}
+
+/*
+ * dev/mem in a capture is a sparse file holding only the ranges that
+ * get read: the legacy BIOS area and the SMBIOS tables it points to.
+ */
+static int capture_devmem(const char *dir, struct libbiosdevname_state *state)
+{
+	struct legacy_bios_area *area;
+	char path[PATH_MAX];
+	int i, fd, rc = 0;
+
+	area = legacy_bios_area(state);
+	snprintf(path, sizeof(path), "%s/dev/mem", dir);
+	if (make_parents(path) ||
+	    (fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0)
+		return 1;
+	if (area) {
+		rc |= capture_mem(fd, LEGACY_BIOS_BASE, LEGACY_BIOS_SIZE, area->mem);
+		for (i=0; i<area->count; i++) {
+			if (area->anchor[i].type != ANCHOR_PIR)
+				rc |= capture_smbios_table(state->config.sysroot, fd, area->mem + area->anchor[i].offset);
+		}
+	}
+	rc |= capture_efi_smbios(state->config.sysroot, fd);
+	close(fd);
+	return rc;
+}
+
+static int capture_firmware(const char *sysroot, const char *dir)
+{
+	const char *files[] = {
+		SYSFS_TABLE_SMBIOS,
+		SYSFS_TABLE_DMI,
+		"/sys/devices/virtual/dmi/id/sys_vendor",
+		"/sys/firmware/efi/systab",
+	};
+	char src[PATH_MAX], dst[PATH_MAX];
+	int i, rc = 0;
+
+	for (i=0; i<sizeof(files)/sizeof(files[0]); i++) {
+		snprintf(src, sizeof(src), "%s%s", sysroot, files[i]);
+		snprintf(dst, sizeof(dst), "%s%s", dir, files[i]);
+		rc |= copy_file(src, dst);
+	}
+	/* its mere presence marks a UEFI system */
+	snprintf(src, sizeof(src), "%s/sys/firmware/efi", sysroot);
+	snprintf(dst, sizeof(dst), "%s/sys/firmware/efi/", dir);
+	if (access(src, F_OK) == 0)
+		rc |= make_parents(dst);
+	return rc;
+}
+
+int capture_inputs(void *cookie, const char *dir)
+{
+	struct libbiosdevname_state *state = cookie;
+	char path[PATH_MAX];
+	int rc = 0;
+
+	if (!state)
+		return 1;
+	snprintf(path, sizeof(path), "%s/", dir);
+	if (make_parents(path)) {
+		fprintf(stderr, "Cannot create %s: %s\n", dir, strerror(errno));
+		return 1;
+	}
+	rc |= capture_pci_sysfs(state->config.sysroot, dir);
+	if (state->pacc)
+		rc |= capture_pci_config(dir, state->pacc);
+	rc |= capture_net(dir, state);
+	rc |= capture_firmware(state->config.sysroot, dir);
+	rc |= capture_devmem(dir, state);
+	if (rc)
+		fprintf(stderr, "Some inputs could not be captured to %s\n", dir);
+	return rc;
+}
@@ -0,0 +1,12 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef CAPTURE_H_INCLUDED
+#define CAPTURE_H_INCLUDED
+
+/* Snapshot every hardware input into dir, for later use with --root */
+extern int capture_inputs(void *cookie, const char *dir);
+
+#endif /* CAPTURE_H_INCLUDED */
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include "config.h"
 #include "types.h"
@@ -39,8 +40,11 @@
 #include "../state.h"
 #include "../pci.h"
 #include "../naming_policy.h"
+#include "../legacy_bios.h"
+#include "../sysfs.h"
+#include "../profile.h"
+#include "../io.h"
 
-extern int smver_mjr, smver_mnr, is_valid_smbios;
 
 #ifdef DEBUG
 #define dprintf printf
@@ -99,24 +103,58 @@ static void strip_right(char *s)
 	}
 }
 
-static int matchpci(struct pci_device *pdev, int domain, int bus, int device, int func)
+static void setslot_dev(const struct libbiosdevname_state *state,
+			struct pci_device *pdev, int domain, int bus,
+			int type, int slot, int index, const char *label)
 {
-	if (domain != -1 && pdev->pci_dev->domain != domain)
-		return 0;
-	if (bus != -1 && pdev->pci_dev->bus != bus)
-		return 0;
-	if (device != -1 && pdev->pci_dev->dev != device)
-		return 0;
-	if (func != -1 && pdev->pci_dev->func != func)
-		return 0;
-	return 1;
+	dprintf("  found device: %.4x:%.2x:%.2x.%x = %lx\n",
+		pdev->pci_dev->domain, pdev->pci_dev->bus, pdev->pci_dev->dev, 
+		pdev->pci_dev->func, pdev->class);
+
+	/* a hotplug rescan leaves every other bus as it was */
+	if (state->rescan_domain >= 0 &&
+	    (domain != state->rescan_domain || bus != state->rescan_bus))
+		goto bridge;
+	/* nor does a late decode change a slot that's already been used */
+	if (pdev->slot_evaluated)
+		goto bridge;
+    
+	pdev->uses_smbios |= HAS_SMBIOS_SLOT;
+	if (index != 0)
+		pdev->uses_smbios |= HAS_SMBIOS_INSTANCE;
+	pdev->smbios_type = type;
+	pdev->smbios_enabled = 1;
+	pdev->smbios_instance = index;
+
+	pdev->physical_slot = slot;
+	pdev->smbios_slot = slot;
+	pdev->slot_source = SLOT_SOURCE_SMBIOS;
+	if (label) {
+		free(pdev->smbios_label);
+		pdev->smbios_label = strdup(label);
+		pdev->uses_smbios |= HAS_SMBIOS_LABEL;
+		strip_right(pdev->smbios_label);
+	}
+    
+bridge:
+	/* Found a PDEV, now is it a bridge? */
+	if (pdev->sbus != -1  && pdev->sbus > bus) {
+		smbios_setslot(state, domain, pdev->sbus, -1, -1, type, slot, index, label);
+	}
 }
 
+/*
+ * device and func may be -1 to match every device on the bus or every
+ * function of the device.  Each candidate address is looked up rather
+ * than walking every PCI device, so a table with thousands of records
+ * costs the same per record on a large system as on a small one.
+ */
 void smbios_setslot(const struct libbiosdevname_state *state, 
 		    int domain, int bus, int device, int func,
 		    int type, int slot, int index, const char *label)
 {
 	struct pci_device *pdev;
+	int dev, fn, lastdev, lastfn;
 
 	dprintf("setslot: %.4x:%.2x:%.2x.%x = type:%x slot(%2d %2d) %s\n",
 		domain, bus, device, func, type, slot, index, label);
@@ -130,36 +168,23 @@ void smbios_setslot(const struct libbiosdevname_state *state,
 		return;
 	}
 
-	list_for_each_entry(pdev, &state->pci_devices, node) {
-		if (!matchpci(pdev, domain, bus, device, func))
-			continue;
-
-		dprintf("  found device: %.4x:%.2x:%.2x.%x = %lx\n",
-			pdev->pci_dev->domain, pdev->pci_dev->bus, pdev->pci_dev->dev, 
-			pdev->pci_dev->func, pdev->class);
-    
-		pdev->uses_smbios |= HAS_SMBIOS_SLOT;
-		if (index != 0)
-			pdev->uses_smbios |= HAS_SMBIOS_INSTANCE;
-		pdev->smbios_type = type;
-		pdev->smbios_enabled = 1;
-		pdev->smbios_instance = index;
-
-		pdev->physical_slot = slot;
-		if (label) {
-			pdev->smbios_label = strdup(label);
-			pdev->uses_smbios |= HAS_SMBIOS_LABEL;
-			strip_right(pdev->smbios_label);
-		}
-    
-		/* Found a PDEV, now is it a bridge? */
-		if (pdev->sbus != -1  && pdev->sbus > bus) {
-			smbios_setslot(state, domain, pdev->sbus, -1, -1, type, slot, index, label);
+	dev = (device == -1) ? 0 : device;
+	lastdev = (device == -1) ? 31 : device;
+	for (; dev <= lastdev; dev++) {
+		fn = (func == -1) ? 0 : func;
+		lastfn = (func == -1) ? 7 : func;
+		for (; fn <= lastfn; fn++) {
+			pdev = find_pci_dev_by_pci_addr(state, domain, bus, dev, fn);
+			if (!pdev)
+				pdev = find_vf_smbios_record(state, domain, bus, dev, fn);
+			if (pdev)
+				setslot_dev(state, pdev, domain, bus, type, slot, index, label);
 		}
 	}
 }
 
-static void dmi_decode(struct dmi_header *h, u16 ver, const struct libbiosdevname_state *state)
+static void dmi_decode(struct dmi_header *h, u16 ver, enum DMI_VENDORS vendor,
+		       const struct libbiosdevname_state *state)
 {
 	u8 *data=h->data;
 
@@ -185,6 +210,8 @@ static void dmi_decode(struct dmi_header *h, u16 ver, const struct libbiosdevnam
 		}
 		break;
 	case 41: /* 3.3.xx Onboard Device Information */
+		if (h->length < 0x0B)
+			break;
 		domain = WORD(data+0x07);
 		bus    = data[0x09];
 		device = (data[0xa]>>3) & 0x1F;
@@ -199,7 +226,7 @@ static void dmi_decode(struct dmi_header *h, u16 ver, const struct libbiosdevnam
 		break;
 
 	default:
-		if(dmi_decode_oem(h, state))
+		if(dmi_decode_oem(h, vendor, state))
 			break;
 	}
 }
@@ -212,47 +239,35 @@ static void to_dmi_header(struct dmi_header *h, u8 *data)
 	h->data=data;
 }
 
-static int isvalidsmbios(int mjr, int mnr)
+static int isvalidsmbios(struct libbiosdevname_state *state, int mjr, int mnr)
 {
+	unsigned int smver_mjr = state->config.smver_mjr, smver_mnr = state->config.smver_mnr;
+
 	if (!smver_mjr && !smver_mnr) {
-		is_valid_smbios = 1;
+		state->is_valid_smbios = 1;
 		return 1;
 	}
 	if (mjr > smver_mjr) {
-		is_valid_smbios = 1;
+		state->is_valid_smbios = 1;
 		return 1;
 	}
 	if ((mjr == smver_mjr) && (mnr >= smver_mnr)) {
-		is_valid_smbios = 1;
+		state->is_valid_smbios = 1;
 		return 1;
 	}
 	return 0;
 }
 
-static int dmi_table(u32 base, u16 len, u16 num, u16 ver, const char *devmem, const struct libbiosdevname_state *state, int sysfs)
+/*
+ * Decode a structure table already in memory.  Returns the number of
+ * structures decoded; the cost is linear in len whatever the contents.
+ */
+int dmi_decode_table(u8 *buf, u32 len, u16 num, u16 ver, const struct libbiosdevname_state *state)
 {
-	u8 *buf;
-	u8 *data;
+	u8 *data=buf;
 	int i=0;
+	enum DMI_VENDORS vendor=VENDOR_UNKNOWN;
 
-	/* Verify SMBIOS version */
-	if (ver && !isvalidsmbios(ver >> 8, ver & 0xFF)) {
-		return 0;
-	}
-
-	if (sysfs)
-		buf = __mem_chunk(0, len, devmem, 0);
-	else
-		buf = mem_chunk(base, len, devmem);
-	if(buf == NULL)
-	{
-#ifndef USE_MMAP
-		printf("Table is unreachable, sorry. Try compiling dmidecode with -DUSE_MMAP.\n");
-#endif
-		return 0;
-	}
-
-	data=buf;
 	while((!num || i<num) && data+4<=buf+len) /* 4 is the length of an SMBIOS structure header */
 	{
 		u8 *next;
@@ -269,26 +284,53 @@ static int dmi_table(u32 base, u16 len, u16 num, u16 ver, const char *devmem, co
 		if(h.length<4)
 			break;
 
-		/* assign vendor for vendor-specific decodes later */
-		if(h.type==0 && h.length>=5)
-			dmi_set_vendor(dmi_string(&h, data[0x04]));
-
 		/* look for the next handle */
 		next=data+h.length;
 		while(next-buf+1<len && (next[0]!=0 || next[1]!=0))
 			next++;
 		next+=2;
+		/* a structure or its strings running off the end is dropped */
 		if(next-buf<=len)
-			dmi_decode(&h, ver, state);
+		{
+			/* assign vendor for vendor-specific decodes later */
+			if(h.type==0 && h.length>=5)
+				vendor=dmi_vendor(dmi_string(&h, data[0x04]));
+			dmi_decode(&h, ver, vendor, state);
+		}
 
 		data=next;
 		i++;
 	}
+	return i;
+}
+
+static int dmi_table(u32 base, u16 len, u16 num, u16 ver, const char *devmem, struct libbiosdevname_state *state, int sysfs)
+{
+	u8 *buf;
+
+	/* Verify SMBIOS version */
+	if (ver && !isvalidsmbios(state, ver >> 8, ver & 0xFF)) {
+		return 0;
+	}
+
+	if (sysfs)
+		buf = __mem_chunk(0, len, devmem, 0);
+	else
+		buf = mem_chunk(base, len, devmem);
+	if(buf == NULL)
+	{
+#ifndef USE_MMAP
+		printf("Table is unreachable, sorry. Try compiling dmidecode with -DUSE_MMAP.\n");
+#endif
+		return 0;
+	}
+
+	profile_items(PROFILE_SMBIOS, dmi_decode_table(buf, len, num, ver, state));
 	free(buf);
 	return 1;
 }
 
-static int smbios_decode(u8 *buf, const char *devmem, const struct libbiosdevname_state *state, int sysfs)
+static int smbios_decode(u8 *buf, const char *devmem, struct libbiosdevname_state *state, int sysfs)
 {
 	if(checksum(buf, buf[0x05])
 	   && memcmp(buf+0x10, "_DMI_", 5)==0
@@ -302,7 +344,7 @@ static int smbios_decode(u8 *buf, const char *devmem, const struct libbiosdevnam
 	return 0;
 }
 
-static int legacy_decode(u8 *buf, const char *devmem, const struct libbiosdevname_state *state)
+static int legacy_decode(u8 *buf, const char *devmem, struct libbiosdevname_state *state)
 {
 	if(checksum(buf, 0x0F))
 	{
@@ -315,31 +357,31 @@ static int legacy_decode(u8 *buf, const char *devmem, const struct libbiosdevnam
 }
 
 /* only from sysfs, handle no base offset */
-static int smbios3_decode(u8 *buf, const char *devmem, const struct libbiosdevname_state *state)
+static int smbios3_decode(u8 *buf, const char *devmem, struct libbiosdevname_state *state)
 {
 	if (checksum(buf, 0x18))
 		return dmi_table(0, DWORD(buf + 0x0c), 0, 0, devmem, state, 1);
 	return 0;
 }
 
-#define SYSFS_TABLE_SMBIOS	"/sys/firmware/dmi/tables/smbios_entry_point"
-#define SYSFS_TABLE_DMI		"/sys/firmware/dmi/tables/DMI"
-
-static int smibios_decode_from_sysfs(const struct libbiosdevname_state *state)
+static int smibios_decode_from_sysfs(struct libbiosdevname_state *state)
 {
 	FILE *fp;
 	u8 buf[0x1f];
 	int len;
+	char path[PATH_MAX];
 
-	fp = fopen(SYSFS_TABLE_SMBIOS, "r");
+	snprintf(path, sizeof(path), "%s%s", state->config.sysroot, SYSFS_TABLE_SMBIOS);
+	fp = io_fopen(path, "r");
 	if (!fp)
 		return 0;
-	len = fread(buf, 1, sizeof(buf), fp);
+	len = io_fread(buf, 1, sizeof(buf), fp);
 	fclose(fp);
+	snprintf(path, sizeof(path), "%s%s", state->config.sysroot, SYSFS_TABLE_DMI);
 	if (len == 0x1f && memcmp(buf, "_SM_", 4) == 0)
-		return smbios_decode(buf, SYSFS_TABLE_DMI, state, 1);
+		return smbios_decode(buf, path, state, 1);
 	if (len >= 0x18 && memcmp(buf, "_SM3_", 5) == 0)
-		return smbios3_decode(buf, SYSFS_TABLE_DMI, state);
+		return smbios3_decode(buf, path, state);
 	return 0;
 }
 
@@ -348,11 +390,12 @@ static int smibios_decode_from_sysfs(const struct libbiosdevname_state *state)
  */
 #define EFI_NOT_FOUND   (-1)
 #define EFI_NO_SMBIOS   (-2)
-static int address_from_efi(size_t *address)
+static int address_from_efi(const char *sysroot, size_t *address)
 {
 	FILE *efi_systab;
 	const char *filename;
 	char linebuf[64];
+	char sys_systab[PATH_MAX], proc_systab[PATH_MAX];
 	int ret;
 
 	*address=0; /* Prevent compiler warning */
@@ -361,14 +404,16 @@ static int address_from_efi(size_t *address)
 	 * Linux up to 2.6.6: /proc/efi/systab
 	 * Linux 2.6.7 and up: /sys/firmware/efi/systab
 	 */
-	if((efi_systab=fopen(filename="/sys/firmware/efi/systab", "r"))==NULL
-	   && (efi_systab=fopen(filename="/proc/efi/systab", "r"))==NULL)
+	snprintf(sys_systab, sizeof(sys_systab), "%s/sys/firmware/efi/systab", sysroot);
+	snprintf(proc_systab, sizeof(proc_systab), "%s/proc/efi/systab", sysroot);
+	if((efi_systab=io_fopen(filename=sys_systab, "r"))==NULL
+	   && (efi_systab=io_fopen(filename=proc_systab, "r"))==NULL)
 	{
 		/* No EFI interface, fallback to memory scan */
 		return EFI_NOT_FOUND;
 	}
 	ret=EFI_NO_SMBIOS;
-	while((fgets(linebuf, sizeof(linebuf)-1, efi_systab))!=NULL)
+	while((io_fgets(linebuf, sizeof(linebuf)-1, efi_systab))!=NULL)
 	{
 		char *addrp=strchr(linebuf, '=');
 		*(addrp++)='\0';
@@ -387,8 +432,6 @@ static int address_from_efi(size_t *address)
 	return ret;
 }
 
-static const char *devmem = "/dev/mem";
-
 int dmidecode_read_file(const struct libbiosdevname_state *state)
 {
 #ifdef _JPH
@@ -440,14 +483,17 @@ int dmidecode_read_file(const struct libbiosdevname_state *state)
 	return 0;
 }
 
-int dmidecode_main(const struct libbiosdevname_state *state)
+int dmidecode_main(struct libbiosdevname_state *state)
 {
 	int ret=0;                  /* Returned value */
 	int found=0;
-	size_t fp;
-	int efi;
+	size_t fp, skip;
+	int efi, i;
 	u8 *buf;
+	struct legacy_bios_area *area;
+	char devmem[PATH_MAX];
 
+	snprintf(devmem, sizeof(devmem), "%s/dev/mem", state->config.sysroot);
 	if (dmidecode_read_file(state))
 		return 0;
 
@@ -456,7 +502,7 @@ int dmidecode_main(const struct libbiosdevname_state *state)
 		return 0;
 
 	/* Next try EFI (ia64, Intel-based Mac) */
-	efi=address_from_efi(&fp);
+	efi=address_from_efi(state->config.sysroot, &fp);
 	switch(efi)
 	{
 	case EFI_NOT_FOUND:
@@ -474,37 +520,37 @@ int dmidecode_main(const struct libbiosdevname_state *state)
 
 	if(smbios_decode(buf, devmem, state, 0))
 		found++;
-	goto done;
+	free(buf);
+	goto exit_free;
 
 memory_scan:
-	/* Fallback to memory scan (x86, x86_64) */
-	if((buf=mem_chunk(0xF0000, 0x10000, devmem))==NULL)
+	/* Fallback to memory scan (x86, x86_64), shared with the $PIR lookup */
+	if((area=legacy_bios_area(state))==NULL)
 	{
 		ret=1;
 		goto exit_free;
 	}
 
-	for(fp=0; fp<=0xFFF0; fp+=16)
+	skip=LEGACY_BIOS_SIZE;
+	for(i=0; i<area->count; i++)
 	{
-		if(memcmp(buf+fp, "_SM_", 4)==0 && fp<=0xFFE0)
+		fp=area->anchor[i].offset;
+		if(area->anchor[i].type==ANCHOR_SM && fp<=0xFFE0)
 		{
-			if(smbios_decode(buf+fp, devmem, state, 0))
+			if(smbios_decode(area->mem+fp, devmem, state, 0))
 			{
 				found++;
-				fp+=16;
+				/* the _DMI_ anchor inside this entry point is done */
+				skip=fp+16;
 			}
 		}
-		else if(memcmp(buf+fp, "_DMI_", 5)==0)
+		else if(area->anchor[i].type==ANCHOR_DMI && fp!=skip)
 		{
-			if (legacy_decode(buf+fp, devmem, state))
+			if (legacy_decode(area->mem+fp, devmem, state))
 				found++;
 		}
 	}
 
-done:
-	free(buf);
-
-
 exit_free:
 	return ret;
 }
@@ -63,8 +63,13 @@ enum dmi_onboard_device_type {
 	DMI_SAS,
 };
 
+#define SYSFS_TABLE_SMBIOS	"/sys/firmware/dmi/tables/smbios_entry_point"
+#define SYSFS_TABLE_DMI		"/sys/firmware/dmi/tables/DMI"
+
 struct libbiosdevname_state;
-int dmidecode_main(const struct libbiosdevname_state *state);
+int dmidecode_main(struct libbiosdevname_state *state);
+int dmi_decode_table(u8 *buf, u32 len, u16 num, u16 ver,
+		     const struct libbiosdevname_state *state);
 
 void smbios_setslot(const struct libbiosdevname_state *state,
 		    int domain, int bus, int device, int func,
@@ -28,22 +28,15 @@
 #include "../pci.h"
 
 /*
- * Globals for vendor-specific decodes
+ * The system vendor, for the decodes that follow in the same table.
+ * Only vendors we know how to decode at least one specific entry type
+ * for are told apart.
  */
-
-enum DMI_VENDORS { VENDOR_UNKNOWN, VENDOR_HP };
-
-static enum DMI_VENDORS dmi_vendor=VENDOR_UNKNOWN;
-
-/*
- * Remember the system vendor for later use. We only actually store the
- * value if we know how to decode at least one specific entry type for
- * that vendor.
- */
-void dmi_set_vendor(const char *s)
+enum DMI_VENDORS dmi_vendor(const char *s)
 {
 	if(strcmp(s, "HP")==0)
-		dmi_vendor=VENDOR_HP;
+		return VENDOR_HP;
+	return VENDOR_UNKNOWN;
 }
 
 /*
@@ -95,9 +88,10 @@ static int dmi_decode_hp(struct dmi_header *h, const struct libbiosdevname_state
  * Dispatch vendor-specific entries decoding
  * Return 1 if decoding was successful, 0 otherwise
  */
-int dmi_decode_oem(struct dmi_header *h, const struct libbiosdevname_state *state)
+int dmi_decode_oem(struct dmi_header *h, enum DMI_VENDORS vendor,
+		   const struct libbiosdevname_state *state)
 {
-	switch(dmi_vendor)
+	switch(vendor)
 	{
 		case VENDOR_HP:
 			return dmi_decode_hp(h, state);
@@ -22,5 +22,8 @@
 #include "../state.h"
 struct dmi_header;
 
-void dmi_set_vendor(const char *s);
-int dmi_decode_oem(struct dmi_header *h, const struct libbiosdevname_state *state);
+enum DMI_VENDORS { VENDOR_UNKNOWN, VENDOR_HP };
+
+enum DMI_VENDORS dmi_vendor(const char *s);
+int dmi_decode_oem(struct dmi_header *h, enum DMI_VENDORS vendor,
+		   const struct libbiosdevname_state *state);
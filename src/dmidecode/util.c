@@ -46,6 +46,7 @@
 
 #include "types.h"
 #include "util.h"
+#include "../io.h"
 
 static int myread(int fd, u8 *buf, size_t count, const char *prefix)
 {
@@ -54,7 +55,7 @@ static int myread(int fd, u8 *buf, size_t count, const char *prefix)
 	
 	while(r2!=count && r!=0)
 	{
-		r=read(fd, buf+r2, count-r2);
+		r=io_read(fd, buf+r2, count-r2);
 		if(r==-1)
 		{
 			if(errno!=EINTR)
@@ -155,7 +156,7 @@ void *__mem_chunk(size_t base, size_t len, const char *devmem, int use_mmap)
 	use_mmap = 0;
 #endif
 
-	if((fd=open(devmem, O_RDONLY))==-1)
+	if((fd=io_open(devmem, O_RDONLY))==-1)
 	{
 		return NULL;
 	}
@@ -17,6 +17,7 @@
 #include <sys/mman.h>
 #include <linux/sockios.h>
 #include <unistd.h>
+#include <dirent.h>
 #include <net/if.h>
 #include <net/if_arp.h>
 #include "ethtool-util.h"
@@ -24,6 +25,8 @@
 #include "eths.h"
 #include "state.h"
 #include "sysfs.h"
+#include "io.h"
+#include "profile.h"
 
 /* Display an Ethernet address in readable format. */
 char *pr_ether(char *buf, const int size, const unsigned char *s)
@@ -35,7 +38,7 @@ char *pr_ether(char *buf, const int size, const unsigned char *s)
 	return (buf);
 }
 
-static int eths_get_phys_port_name_id(const char *devname)
+static int eths_get_phys_port_name_id(const char *sysroot, const char *devname)
 {
 	char *portstr = NULL;
 	char path[PATH_MAX];
@@ -44,7 +47,7 @@ static int eths_get_phys_port_name_id(const char *devname)
 	/* Only devices that have a phys_port_name of 'pX' are considered here,
 	 * with the index 'X' extracted.
 	 */
-	snprintf(path, sizeof(path), "/sys/class/net/%s/phys_port_name", devname);
+	snprintf(path, sizeof(path), "%s/sys/class/net/%s/phys_port_name", sysroot, devname);
 	if (sysfs_read_file(path, &portstr) == 0) {
 		char *res = NULL;
 
@@ -61,7 +64,7 @@ static int eths_get_phys_port_name_id(const char *devname)
 	return index;
 }
 
-static void eths_get_dev_eligible(struct network_device *dev)
+static void eths_get_dev_eligible(const char *sysroot, struct network_device *dev)
 {
 	/* By default, all network devices are eligible for naming. Some may
 	 * opt-out explicitly below.
@@ -69,11 +72,11 @@ static void eths_get_dev_eligible(struct network_device *dev)
 	dev->is_eligible = 1;
 
 	if (dev->drvinfo_valid && strcmp(dev->drvinfo.driver, "nfp") == 0) {
-		dev->is_eligible = (eths_get_phys_port_name_id(dev->kernel_name) >= 0 ? 1 : 0);
+		dev->is_eligible = (eths_get_phys_port_name_id(sysroot, dev->kernel_name) >= 0 ? 1 : 0);
 	}
 }
 
-static void eths_get_devid(struct network_device *dev)
+static void eths_get_devid(const char *sysroot, struct network_device *dev)
 {
 	char path[PATH_MAX];
 	char *devidstr = NULL;
@@ -84,14 +87,14 @@ static void eths_get_devid(struct network_device *dev)
 	 * dev ID to use instead of the dev_port attribute.
 	 */
 	if (dev->drvinfo_valid && strcmp(dev->drvinfo.driver, "nfp") == 0) {
-		dev->devid = eths_get_phys_port_name_id(dev->kernel_name);
+		dev->devid = eths_get_phys_port_name_id(sysroot, dev->kernel_name);
 	} else {
-		snprintf(path, sizeof(path), "/sys/class/net/%s/dev_port", dev->kernel_name);
+		snprintf(path, sizeof(path), "%s/sys/class/net/%s/dev_port", sysroot, dev->kernel_name);
 		if (sysfs_read_file(path, &devidstr) == 0) {
 			sscanf(devidstr, "%i", &dev->devid);
 			free(devidstr);
 		} else {
-			snprintf(path, sizeof(path), "/sys/class/net/%s/dev_id", dev->kernel_name);
+			snprintf(path, sizeof(path), "%s/sys/class/net/%s/dev_id", sysroot, dev->kernel_name);
 			if (sysfs_read_file(path, &devidstr) == 0) {
 				sscanf(devidstr, "%i", &dev->devid);
 				free(devidstr);
@@ -100,7 +103,7 @@ static void eths_get_devid(struct network_device *dev)
 	}
 }
 
-static int eths_get_devtype(struct network_device *dev)
+static int eths_get_devtype(const char *sysroot, struct network_device *dev)
 {
 	int fd;
 	int ret = 0;
@@ -109,7 +112,7 @@ static int eths_get_devtype(struct network_device *dev)
 	char *result = NULL, *n, *temp;
 	unsigned long resultsize = 0, devtype_len = 0;
 
-	snprintf(path, sizeof(path), "/sys/class/net/%s/uevent", dev->kernel_name);
+	snprintf(path, sizeof(path), "%s/sys/class/net/%s/uevent", sysroot, dev->kernel_name);
 
 	resultsize = getpagesize();
 	result = malloc(resultsize);
@@ -117,13 +120,13 @@ static int eths_get_devtype(struct network_device *dev)
 		return -ENOMEM;
 	memset(result, 0, resultsize);
 
-	fd = open(path, O_RDONLY);
+	fd = io_open(path, O_RDONLY);
 	if (fd < 0) {
 		ret = fd;
 		goto free_out;
 	}
 
-	length = read(fd, result, resultsize-1);
+	length = io_read(fd, result, resultsize-1);
 	close(fd);
 
 	if (length < 0) {
@@ -162,13 +165,13 @@ static int eths_get_ifindex(const char *devname, int *ifindex)
 	strncpy(ifr.ifr_name, devname, sizeof(ifr.ifr_name)-1);
 
 	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	fd = io_socket(AF_INET, SOCK_DGRAM, 0);
 	if (fd < 0) {
 		perror("Cannot get control socket");
 		return 1;
 	}
 
-	err = ioctl(fd, SIOCGIFINDEX, &ifr);
+	err = io_ioctl(fd, SIOCGIFINDEX, &ifr);
 	if (!err) {
 	   	*ifindex = ifr.ifr_ifindex;
 	}
@@ -185,13 +188,13 @@ static int eths_get_hwaddr(const char *devname, unsigned char *buf, int size, in
 	strncpy(ifr.ifr_name, devname, sizeof(ifr.ifr_name)-1);
 
 	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	fd = io_socket(AF_INET, SOCK_DGRAM, 0);
 	if (fd < 0) {
 		perror("Cannot get control socket");
 		return 1;
 	}
 
-	err = ioctl(fd, SIOCGIFHWADDR, &ifr);
+	err = io_ioctl(fd, SIOCGIFHWADDR, &ifr);
 	if (!err) {
 		memcpy(buf, ifr.ifr_hwaddr.sa_data, min(size, sizeof(ifr.ifr_hwaddr.sa_data)));
 		*type = ifr.ifr_hwaddr.sa_family;
@@ -210,7 +213,7 @@ static int eths_get_info(const char *devname, struct ethtool_drvinfo *drvinfo)
 	strncpy(ifr.ifr_name, devname, sizeof(ifr.ifr_name)-1);
 
 	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	fd = io_socket(AF_INET, SOCK_DGRAM, 0);
 	if (fd < 0) {
 		perror("Cannot get control socket");
 		return 1;
@@ -218,7 +221,7 @@ static int eths_get_info(const char *devname, struct ethtool_drvinfo *drvinfo)
 
 	drvinfo->cmd = ETHTOOL_GDRVINFO;
 	ifr.ifr_data = (caddr_t)drvinfo;
-	err = ioctl(fd, SIOCETHTOOL, &ifr);
+	err = io_ioctl(fd, SIOCETHTOOL, &ifr);
 	close(fd);
 	return err;
 }
@@ -242,7 +245,7 @@ static int eths_get_permaddr(const char *devname, unsigned char *buf, int size)
 
 
 	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	fd = io_socket(AF_INET, SOCK_DGRAM, 0);
 	if (fd < 0) {
 		free(permaddr);
 		perror("Cannot get control socket");
@@ -252,7 +255,7 @@ static int eths_get_permaddr(const char *devname, unsigned char *buf, int size)
 	permaddr->cmd = ETHTOOL_GPERMADDR;
 	permaddr->size = MAX_ADDR_LEN;
 	ifr.ifr_data = (caddr_t)permaddr;
-	err = ioctl(fd, SIOCETHTOOL, &ifr);
+	err = io_ioctl(fd, SIOCETHTOOL, &ifr);
 	if (err < 0) {
 		close(fd);
 		free(permaddr);
@@ -264,20 +267,114 @@ static int eths_get_permaddr(const char *devname, unsigned char *buf, int size)
 	return err;
 }
 
-static void fill_eth_dev(struct network_device *dev)
+static void unparse_addr(FILE *fp, const char *key, const unsigned char *addr, int size)
 {
+	int i;
+
+	/* trailing zero bytes are implied */
+	while (size > 0 && addr[size-1] == 0)
+		size--;
+	fprintf(fp, "%s:", key);
+	for (i=0; i<size; i++)
+		fprintf(fp, "%s%02x", i ? ":" : " ", addr[i]);
+	fprintf(fp, "\n");
+}
+
+static void parse_addr(const char *s, unsigned char *addr, int size)
+{
+	unsigned int byte;
+	int i, n;
+
+	for (i=0; i<size && sscanf(s, " %2x%n", &byte, &n) == 1; i++) {
+		addr[i] = byte;
+		s += n;
+		if (*s == ':')
+			s++;
+	}
+}
+
+/*
+ * Save what the socket ioctls returned for this device, in the same
+ * "key: value" form as ethtool -i, so a capture can be replayed.
+ */
+int save_eth_dev(FILE *fp, const struct network_device *dev)
+{
+	if (drvinfo_valid(dev)) {
+		fprintf(fp, "driver: %s\n", dev->drvinfo.driver);
+		fprintf(fp, "version: %s\n", dev->drvinfo.version);
+		fprintf(fp, "firmware-version: %s\n", dev->drvinfo.fw_version);
+		fprintf(fp, "bus-info: %s\n", dev->drvinfo.bus_info);
+	}
+	fprintf(fp, "ifindex: %d\n", dev->ifindex);
+	fprintf(fp, "type: %d\n", dev->arphrd_type);
+	unparse_addr(fp, "address", dev->dev_addr, sizeof(dev->dev_addr));
+	unparse_addr(fp, "permaddr", dev->perm_addr, sizeof(dev->perm_addr));
+	return ferror(fp);
+}
+
+#define copy_field(field, value) \
+	strncpy(field, value, sizeof(field)-1)
+
+static int eths_read_saved(const char *sysroot, struct network_device *dev)
+{
+	char path[PATH_MAX];
+	char line[256], *value, *n;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s/%s", sysroot, ETHTOOL_DUMP_DIR, dev->kernel_name);
+	fp = io_fopen(path, "r");
+	if (!fp)
+		return 1;
+	while (io_fgets(line, sizeof(line), fp) != NULL) {
+		if ((n = strchr(line, '\n')) != NULL)
+			*n = '\0';
+		if ((value = strstr(line, ": ")) == NULL)
+			continue;
+		*value = '\0';
+		value += 2;
+		if (!strcmp(line, "driver")) {
+			copy_field(dev->drvinfo.driver, value);
+			dev->drvinfo_valid = 1;
+		} else if (!strcmp(line, "version"))
+			copy_field(dev->drvinfo.version, value);
+		else if (!strcmp(line, "firmware-version"))
+			copy_field(dev->drvinfo.fw_version, value);
+		else if (!strcmp(line, "bus-info"))
+			copy_field(dev->drvinfo.bus_info, value);
+		else if (!strcmp(line, "ifindex"))
+			sscanf(value, "%d", &dev->ifindex);
+		else if (!strcmp(line, "type"))
+			sscanf(value, "%d", &dev->arphrd_type);
+		else if (!strcmp(line, "address"))
+			parse_addr(value, dev->dev_addr, sizeof(dev->dev_addr));
+		else if (!strcmp(line, "permaddr"))
+			parse_addr(value, dev->perm_addr, sizeof(dev->perm_addr));
+	}
+	fclose(fp);
+	return 0;
+}
+
+static void fill_eth_dev(const struct libbiosdevname_state *state, struct network_device *dev)
+{
+	const char *sysroot = state->config.sysroot;
 	int rc, devtype;
-	eths_get_ifindex(dev->kernel_name, &dev->ifindex);
-	eths_get_hwaddr(dev->kernel_name, dev->dev_addr, sizeof(dev->dev_addr), &dev->arphrd_type);
-	eths_get_permaddr(dev->kernel_name, dev->perm_addr, sizeof(dev->perm_addr));
-	devtype = eths_get_devtype(dev);
+	if (*sysroot) {
+		eths_read_saved(sysroot, dev);
+	} else {
+		eths_get_ifindex(dev->kernel_name, &dev->ifindex);
+		eths_get_hwaddr(dev->kernel_name, dev->dev_addr, sizeof(dev->dev_addr), &dev->arphrd_type);
+		eths_get_permaddr(dev->kernel_name, dev->perm_addr, sizeof(dev->perm_addr));
+	}
+	devtype = eths_get_devtype(sysroot, dev);
 	if (devtype > 0)
 		dev->devtype_is_fcoe = 1;
-	rc = eths_get_info(dev->kernel_name, &dev->drvinfo);
-	if (rc == 0)
-		dev->drvinfo_valid = 1;
-	eths_get_devid(dev);
-	eths_get_dev_eligible(dev);
+	if (!*sysroot) {
+		rc = eths_get_info(dev->kernel_name, &dev->drvinfo);
+		if (rc == 0)
+			dev->drvinfo_valid = 1;
+	}
+	eths_get_devid(sysroot, dev);
+	eths_get_dev_eligible(sysroot, dev);
 }
 
 void free_eths(struct libbiosdevname_state *state)
@@ -285,20 +382,217 @@ void free_eths(struct libbiosdevname_state *state)
 	struct network_device *pos, *next;
 	list_for_each_entry_safe(pos, next, &state->network_devices, node) {
 		list_del(&pos->node);
+		free(pos->cost);
 		free(pos);
 	}
+	hash_table_free(&state->netdevs_by_bus_info);
+	hash_table_free(&state->netdevs_by_name);
+	state->netdev_count = 0;
 }
 
 /* read_proc.c */
 extern int get_interfaces(struct libbiosdevname_state *state);
+extern struct network_device *add_interface(struct libbiosdevname_state *state,
+					    const char *name);
+
+static unsigned int hash_bus_info(const char *bus_info)
+{
+	return hash_strn(bus_info, sizeof(((struct ethtool_drvinfo *)0)->bus_info));
+}
+
+/*
+ * Index the network devices by bus_info, so matching them against PCI
+ * devices doesn't have to compare every pair.  Devices sharing a
+ * bus_info stay in /proc/net/dev order within their bucket.  Without
+ * the index, lookups fall back to walking every network device.
+ */
+void hash_eths(struct libbiosdevname_state *state)
+{
+	struct network_device *pos;
+	unsigned int count = 0;
+
+	list_for_each_entry(pos, &state->network_devices, node)
+		count++;
+	if (hash_table_init(&state->netdevs_by_bus_info, count))
+		return;
+	list_for_each_entry(pos, &state->network_devices, node)
+		hash_eth(state, pos);
+}
+
+/* Index one more network device, e.g. one that appeared after setup */
+void hash_eth(struct libbiosdevname_state *state, struct network_device *dev)
+{
+	/* no index, so lookups walk state->network_devices, which has dev */
+	if (!state->netdevs_by_bus_info.size)
+		return;
+	list_add_tail(&dev->bus_info_node,
+		      hash_bucket(&state->netdevs_by_bus_info, hash_bus_info(dev->drvinfo.bus_info)));
+}
+
+static unsigned int hash_eth_kernel_name(const char *name)
+{
+	return hash_strn(name, IFNAMSIZ);
+}
+
+/* Rebuild the name index at twice the size, keeping the old one on failure */
+static int rehash_eth_names(struct libbiosdevname_state *state)
+{
+	struct hash_table t;
+	struct network_device *pos;
+
+	if (hash_table_init(&t, state->netdev_count * 2))
+		return 1;
+	hash_table_free(&state->netdevs_by_name);
+	state->netdevs_by_name = t;
+	list_for_each_entry(pos, &state->network_devices, node)
+		list_add_tail(&pos->name_node,
+			      hash_bucket(&t, hash_eth_kernel_name(pos->kernel_name)));
+	return 0;
+}
+
+/*
+ * Index a network device just added to state->network_devices by its
+ * kernel name.  Devices are added one at a time, so the index grows
+ * with them.  With no index at all, find_eth() walks the list.
+ */
+void hash_eth_name(struct libbiosdevname_state *state, struct network_device *dev)
+{
+	if (++state->netdev_count > state->netdevs_by_name.size &&
+	    !rehash_eth_names(state))
+		return;
+	if (state->netdevs_by_name.size)
+		list_add_tail(&dev->name_node,
+			      hash_bucket(&state->netdevs_by_name, hash_eth_kernel_name(dev->kernel_name)));
+}
+
+/* Change an interface's kernel name, keeping it findable by find_eth() */
+void rename_eth(struct libbiosdevname_state *state, struct network_device *dev, const char *name)
+{
+	list_del_init(&dev->name_node);
+	snprintf(dev->kernel_name, sizeof(dev->kernel_name), "%s", name);
+	if (state->netdevs_by_name.size)
+		list_add_tail(&dev->name_node,
+			      hash_bucket(&state->netdevs_by_name, hash_eth_kernel_name(dev->kernel_name)));
+}
+
+void free_eth(struct libbiosdevname_state *state, struct network_device *dev)
+{
+	list_del(&dev->node);
+	list_del_init(&dev->bus_info_node);
+	list_del_init(&dev->name_node);
+	state->netdev_count--;
+	free(dev->cost);
+	free(dev);
+}
 
 void get_eths(struct libbiosdevname_state *state)
 {
 	struct network_device *pos;
 	get_interfaces(state);
 	list_for_each_entry(pos, &state->network_devices, node) {
-		fill_eth_dev(pos);
+		profile_device_begin(&pos->cost, SOURCE_NETDEV, "%s", pos->kernel_name);
+		fill_eth_dev(state, pos);
+		profile_device_end();
+		profile_items(PROFILE_ETHS, 1);
 	}
+	hash_eths(state);
+}
+
+struct network_device *find_eth(struct libbiosdevname_state *state,
+				const char *name)
+{
+	struct network_device *pos;
+	struct list_head *bucket;
+
+	if (!state->netdevs_by_name.size) {
+		list_for_each_entry(pos, &state->network_devices, node) {
+			if (!strncmp(pos->kernel_name, name, sizeof(pos->kernel_name)))
+				return pos;
+		}
+		return NULL;
+	}
+	bucket = hash_bucket(&state->netdevs_by_name, hash_eth_kernel_name(name));
+	list_for_each_entry(pos, bucket, name_node) {
+		if (!strncmp(pos->kernel_name, name, sizeof(pos->kernel_name)))
+			return pos;
+	}
+	return NULL;
+}
+
+/* Read one interface, by name, without looking at any of the others */
+struct network_device *get_eth(struct libbiosdevname_state *state, const char *name)
+{
+	struct network_device *dev;
+
+	dev = find_eth(state, name);
+	if (dev)
+		return dev;
+	dev = add_interface(state, name);
+	if (!dev)
+		return NULL;
+	profile_device_begin(&dev->cost, SOURCE_NETDEV, "%s", dev->kernel_name);
+	fill_eth_dev(state, dev);
+	profile_device_end();
+	profile_items(PROFILE_ETHS, 1);
+	return dev;
+}
+
+/* An interface's ifindex, read the way fill_eth_dev() reads it */
+int read_eth_ifindex(const char *sysroot, const char *name, int *ifindex)
+{
+	struct network_device dev;
+
+	if (!*sysroot)
+		return eths_get_ifindex(name, ifindex);
+	memset(&dev, 0, sizeof(dev));
+	strncpy(dev.kernel_name, name, sizeof(dev.kernel_name)-1);
+	if (eths_read_saved(sysroot, &dev))
+		return 1;
+	*ifindex = dev.ifindex;
+	return 0;
+}
+
+/*
+ * The PCI function an interface is bound to, from its sysfs device link.
+ * Fails for virtual interfaces, which have none.
+ */
+int read_eth_pci_name(const char *sysroot, const char *name, char *buf, int size)
+{
+	char path[PATH_MAX], link[PATH_MAX];
+	char *base;
+	ssize_t len;
+
+	snprintf(path, sizeof(path), "%s/sys/class/net/%s/device", sysroot, name);
+	len = io_readlink(path, link, sizeof(link)-1);
+	if (len < 0)
+		return 1;
+	link[len] = '\0';
+	base = strrchr(link, '/');
+	snprintf(buf, size, "%s", base ? base+1 : link);
+	return 0;
+}
+
+/*
+ * Read the interfaces bound to one PCI function, as listed in its sysfs
+ * net directory.  A function without a driver has no such directory,
+ * and no interfaces.
+ */
+void get_pci_eths(struct libbiosdevname_state *state, const char *pci_name)
+{
+	char path[PATH_MAX];
+	struct dirent **namelist;
+	int i, n;
+
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/net", state->config.sysroot, pci_name);
+	n = io_scandir(path, &namelist, NULL, alphasort);
+	if (n < 0)
+		return;
+	for (i=0; i<n; i++) {
+		if (namelist[i]->d_name[0] != '.')
+			get_eth(state, namelist[i]->d_name);
+		free(namelist[i]);
+	}
+	free(namelist);
 }
 
 int zero_mac(const void *addr)
@@ -324,20 +618,49 @@ int unparse_network_device(char *buf, const int size, struct network_device *dev
 		s += snprintf(s, size-(s-buf), "Firmware version: %s\n", dev->drvinfo.fw_version);
 		s += snprintf(s, size-(s-buf), "Bus Info: %s\n", dev->drvinfo.bus_info);
 	}
+	if (profile_enabled)
+		s += unparse_cost(s, size-(s-buf), dev->cost);
 	return (s-buf);
 };
 
-struct network_device * find_net_device_by_bus_info(struct libbiosdevname_state *state,
-						    const char *bus_info)
+/*
+ * The network device after prev (or the first, when prev is NULL) with
+ * this bus_info, in /proc/net/dev order.  Uses the bus_info index when
+ * there is one, and walks every network device when there isn't.
+ */
+struct network_device * next_net_device_by_bus_info(struct libbiosdevname_state *state,
+						    const char *bus_info,
+						    struct network_device *prev)
 {
+	struct list_head *head, *pos;
 	struct network_device *n;
-	list_for_each_entry(n, &state->network_devices, node) {
+	int hashed = state->netdevs_by_bus_info.size != 0;
+
+	if (hashed)
+		head = hash_bucket(&state->netdevs_by_bus_info, hash_bus_info(bus_info));
+	else
+		head = &state->network_devices;
+	if (prev)
+		pos = hashed ? prev->bus_info_node.next : prev->node.next;
+	else
+		pos = head->next;
+	for (; pos != head; pos = pos->next) {
+		if (hashed)
+			n = list_entry(pos, struct network_device, bus_info_node);
+		else
+			n = list_entry(pos, struct network_device, node);
 		if (!strncmp(n->drvinfo.bus_info, bus_info, sizeof(n->drvinfo.bus_info)))
 			return n;
 	}
 	return NULL;
 }
 
+struct network_device * find_net_device_by_bus_info(struct libbiosdevname_state *state,
+						    const char *bus_info)
+{
+	return next_net_device_by_bus_info(state, bus_info, NULL);
+}
+
 int is_ethernet(struct network_device *dev)
 {
 	int i;
@@ -6,6 +6,7 @@
 #ifndef __ETHS_H_INCLUDED
 #define __ETHS_H_INCLUDED
 
+#include <stdio.h>
 #include <net/if.h>
 #include <net/if_arp.h>
 
@@ -16,9 +17,12 @@
 #include "list.h"
 #include "ethtool-util.h"
 #include "state.h"
+#include "profile.h"
 
 struct network_device {
 	struct list_head node;
+	struct list_head bus_info_node;	/* in state->netdevs_by_bus_info */
+	struct list_head name_node;	/* in state->netdevs_by_name */
 	char kernel_name[IFNAMSIZ];          /* ethN */
 	unsigned char perm_addr[MAX_ADDR_LEN];
 	unsigned char dev_addr[MAX_ADDR_LEN];   /* mutable MAC address, not unparsed */
@@ -31,13 +35,34 @@ struct network_device {
 	int devtype_is_fcoe;
 	char *devtype;
 	int is_eligible:1; /* not eligible for naming when 0 */
+	struct io_stats *cost;	/* per profile_source, while profiling */
 };
 
+/* Socket ioctl results for each interface, kept in a capture directory */
+#define ETHTOOL_DUMP_DIR "ethtool"
+
 extern void get_eths(struct libbiosdevname_state *state);
+extern struct network_device *get_eth(struct libbiosdevname_state *state, const char *name);
+extern void get_pci_eths(struct libbiosdevname_state *state, const char *pci_name);
+extern int read_eth_ifindex(const char *sysroot, const char *name, int *ifindex);
+extern int read_eth_pci_name(const char *sysroot, const char *name, char *buf, int size);
+extern void hash_eths(struct libbiosdevname_state *state);
+extern void hash_eth(struct libbiosdevname_state *state, struct network_device *dev);
+extern struct network_device *find_eth(struct libbiosdevname_state *state, const char *name);
+extern void hash_eth_name(struct libbiosdevname_state *state, struct network_device *dev);
+extern void rename_eth(struct libbiosdevname_state *state, struct network_device *dev, const char *name);
+extern void free_eth(struct libbiosdevname_state *state, struct network_device *dev);
+extern int save_eth_dev(FILE *fp, const struct network_device *dev);
 extern void free_eths(struct libbiosdevname_state *state);
 extern int unparse_network_device(char *buf, const int size, struct network_device *dev);
 extern struct network_device * find_net_device_by_bus_info(struct libbiosdevname_state *state,
 							   const char *bus_info);
+extern struct network_device * next_net_device_by_bus_info(struct libbiosdevname_state *state,
+							   const char *bus_info,
+							   struct network_device *prev);
+#define for_each_net_device_by_bus_info(n, state, bus_info)			\
+	for (n = next_net_device_by_bus_info(state, bus_info, NULL); n;		\
+	     n = next_net_device_by_bus_info(state, bus_info, n))
 extern int is_ethernet(struct network_device *dev);
 
 extern int zero_mac(const void *addr);
@@ -49,6 +74,11 @@ static inline void claim_netdev(struct network_device *dev)
 	dev->hardware_claimed = 1;
 }
 
+static inline void unclaim_netdev(struct network_device *dev)
+{
+	dev->hardware_claimed = 0;
+}
+
 static inline int netdev_is_claimed(const struct network_device *dev)
 {
 	return dev->hardware_claimed != 0;
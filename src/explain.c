@@ -0,0 +1,294 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Report where each part of a device's name came from, which other
+ * sources were consulted on the way or never needed, and what each one
+ * cost.  The source lists mirror the order of use_physical() and
+ * dev_to_slot(): everything before the winner came up empty, and
+ * everything after it was skipped.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "bios_device.h"
+#include "state.h"
+#include "libbiosdevname.h"
+#include "naming_policy.h"
+#include "profile.h"
+#include "explain.h"
+
+static const char *name_sources[] = {
+	[NAME_SOURCE_NONE]		= "none",
+	[NAME_SOURCE_DRIVER_PORT]	= "multiport driver dev_id",
+	[NAME_SOURCE_SYSFS_INDEX]	= "ACPI index in sysfs",
+	[NAME_SOURCE_SMBIOS_INSTANCE]	= "SMBIOS type 41 instance",
+	[NAME_SOURCE_EMBEDDED_INDEX]	= "embedded NIC order",
+	[NAME_SOURCE_SLOT]		= "physical slot",
+	[NAME_SOURCE_VPD_PORT]		= "Dell VPD port",
+	[NAME_SOURCE_INDEX_IN_SLOT]	= "order in slot",
+	[NAME_SOURCE_PF_INDEX_IN_SLOT]	= "PF order in slot",
+	[NAME_SOURCE_DRIVER_PFI]	= "multiport driver VF index",
+	[NAME_SOURCE_VF_INDEX]		= "SR-IOV VF index",
+	[NAME_SOURCE_VPD_PFI]		= "Dell VPD partition",
+};
+
+static const char *slot_sources[] = {
+	[SLOT_SOURCE_NONE]	= "none",
+	[SLOT_SOURCE_SMBIOS]	= "SMBIOS type 9/41",
+	[SLOT_SOURCE_PCIE]	= "PCIe slot capability",
+	[SLOT_SOURCE_PIRQ]	= "$PIR table",
+	[SLOT_SOURCE_VPD]	= "Dell VPD master function",
+	[SLOT_SOURCE_PF]	= "SR-IOV PF",
+};
+
+static const int embedded_order[] = {
+	NAME_SOURCE_DRIVER_PORT, NAME_SOURCE_SYSFS_INDEX,
+	NAME_SOURCE_SMBIOS_INSTANCE, NAME_SOURCE_EMBEDDED_INDEX, -1
+};
+static const int port_order[] = {
+	NAME_SOURCE_DRIVER_PORT, NAME_SOURCE_VPD_PORT, NAME_SOURCE_INDEX_IN_SLOT, -1
+};
+static const int vf_port_order[] = {
+	NAME_SOURCE_DRIVER_PORT, NAME_SOURCE_VPD_PORT, NAME_SOURCE_PF_INDEX_IN_SLOT, -1
+};
+static const int interface_order[] = {
+	NAME_SOURCE_DRIVER_PFI, NAME_SOURCE_VF_INDEX, NAME_SOURCE_VPD_PFI, -1
+};
+static const int slot_order[] = {
+	SLOT_SOURCE_SMBIOS, SLOT_SOURCE_PCIE, SLOT_SOURCE_PIRQ, -1
+};
+
+static const struct io_stats *device_cost(const struct pci_device *p, int source)
+{
+	if (!p || !p->cost)
+		return NULL;
+	return &p->cost[source];
+}
+
+static void print_cost(const char *what, const struct io_stats *cost)
+{
+	char buf[256];
+
+	if (!cost) {
+		printf("  -\n");
+		return;
+	}
+	unparse_io_stats(buf, sizeof(buf), cost);
+	printf("  %s%s\n", what, buf);
+}
+
+static void print_phase_cost(enum profile_phase phase)
+{
+	struct io_stats cost;
+
+	profile_phase_cost(phase, &cost);
+	print_cost("shared: ", &cost);
+}
+
+/* The PCI function whose VPD, sysfs and SMBIOS data use_physical() read */
+static struct pci_device *master(struct pci_device *p)
+{
+	if (p->vpd_pf)
+		p = p->vpd_pf;
+	if (p->pf)
+		p = p->pf;
+	return p;
+}
+
+static void print_name_source(const struct bios_device *dev, int source)
+{
+	struct pci_device *p = dev->pcidev;
+
+	switch (source) {
+	case NAME_SOURCE_DRIVER_PORT:
+	case NAME_SOURCE_DRIVER_PFI:
+		print_cost("", dev->netdev->cost ? &dev->netdev->cost[SOURCE_NETDEV] : NULL);
+		break;
+	case NAME_SOURCE_SYSFS_INDEX:
+		print_cost("", device_cost(master(p), SOURCE_SYSFS));
+		break;
+	case NAME_SOURCE_SMBIOS_INSTANCE:
+		print_phase_cost(PROFILE_SMBIOS);
+		break;
+	case NAME_SOURCE_VPD_PORT:
+	case NAME_SOURCE_VPD_PFI:
+		print_cost("", device_cost(p, SOURCE_VPD));
+		break;
+	case NAME_SOURCE_VF_INDEX:
+		print_cost("on the PF: ", device_cost(p->pf, SOURCE_SRIOV));
+		break;
+	default:
+		printf("  derived\n");
+		break;
+	}
+}
+
+static void print_slot_source(const struct pci_device *p, int source)
+{
+	struct io_stats cost;
+
+	switch (source) {
+	case SLOT_SOURCE_SMBIOS:
+		print_phase_cost(PROFILE_SMBIOS);
+		break;
+	case SLOT_SOURCE_PCIE:
+		if (p->cost) {
+			cost = p->cost[SOURCE_PCIE_SLOT];
+			io_stats_add(&cost, &p->cost[SOURCE_PARENT]);
+			print_cost("with parents: ", &cost);
+		} else
+			printf("  -\n");
+		break;
+	case SLOT_SOURCE_PIRQ:
+		print_cost("", device_cost(p, SOURCE_PIRQ));
+		break;
+	case SLOT_SOURCE_VPD:
+		print_cost("", device_cost(p, SOURCE_VPD));
+		break;
+	default:
+		printf("  -\n");
+		break;
+	}
+}
+
+static const char *status(const int *order, int i, int used)
+{
+	int j;
+
+	if (order[i] == used)
+		return "used";
+	for (j=0; j<i; j++) {
+		if (order[j] == used)
+			return "skipped";
+	}
+	return "unavailable";
+}
+
+static void explain_part(const struct bios_device *dev, const char *part,
+			 const int *order, int used)
+{
+	int i;
+
+	printf("%s: %s\n", part, used ? name_sources[used] : "not found");
+	for (i=0; order[i] >= 0; i++) {
+		printf("  %-12s %-28s", status(order, i, used), name_sources[order[i]]);
+		print_name_source(dev, order[i]);
+	}
+}
+
+static void explain_slot(const struct libbiosdevname_state *state, const struct pci_device *p)
+{
+	char pci_name[16];
+	int i;
+
+	printf("slot: ");
+	if (p->physical_slot == 0)
+		printf("embedded");
+	else if (p->physical_slot < PHYSICAL_SLOT_UNKNOWN)
+		printf("%d", p->physical_slot);
+	else
+		printf("unknown");
+	printf(", from %s", slot_sources[p->slot_source]);
+	if (p->slot_parent) {
+		unparse_pci_name(pci_name, sizeof(pci_name), p->slot_parent->pci_dev);
+		printf(" of parent %s", pci_name);
+	}
+	printf("\n");
+	if (p->slot_source == SLOT_SOURCE_VPD || p->slot_source == SLOT_SOURCE_PF) {
+		printf("  %-12s %-28s", "used", slot_sources[p->slot_source]);
+		print_slot_source(p, p->slot_source);
+		return;
+	}
+	for (i=0; slot_order[i] >= 0; i++) {
+		if ((slot_order[i] == SLOT_SOURCE_PCIE && !state->is_valid_smbios) ||
+		    (slot_order[i] == SLOT_SOURCE_PIRQ && state->config.nopirq))
+			printf("  %-12s %-28s\n", "disabled", slot_sources[slot_order[i]]);
+		else {
+			printf("  %-12s %-28s", status(slot_order, i, p->slot_source),
+			       slot_sources[slot_order[i]]);
+			print_slot_source(p, slot_order[i]);
+		}
+	}
+}
+
+static int is_empty(const struct io_stats *cost)
+{
+	int i;
+
+	for (i=0; i<IO_KINDS; i++) {
+		if (cost->n[i])
+			return 0;
+	}
+	return !cost->ns;
+}
+
+static void explain_cost(const char *what, const struct io_stats *cost)
+{
+	static const char *names[PROFILE_SOURCES] = {
+		[SOURCE_PCI]		= "config space",
+		[SOURCE_SYSFS]		= "sysfs index/label",
+		[SOURCE_SRIOV]		= "SR-IOV",
+		[SOURCE_VPD]		= "VPD",
+		[SOURCE_PCIE_SLOT]	= "PCIe slot",
+		[SOURCE_PARENT]		= "parent walk",
+		[SOURCE_PIRQ]		= "$PIR",
+		[SOURCE_NETDEV]		= "netdev",
+	};
+	int i;
+
+	if (!cost)
+		return;
+	printf("cost for %s:\n", what);
+	for (i=0; i<PROFILE_SOURCES; i++) {
+		if (is_empty(&cost[i]))
+			continue;
+		printf("  %-41s", names[i]);
+		print_cost("", &cost[i]);
+	}
+}
+
+/* Returns 0, or 2 when devname isn't known, like kern_to_bios() */
+int explain_bios_device(void *cookie, const char *devname)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct bios_device *dev;
+	struct pci_device *p;
+	char pci_name[16];
+
+	if (!state)
+		return 2;
+	dev = find_bios_device_by_name(state, devname);
+	if (!dev)
+		return 2;
+	printf("%s: %s%s\n", devname, dev->bios_name ? dev->bios_name : "(no name)",
+	       dev->duplicate ? " (duplicate, not used)" : "");
+	p = dev->pcidev;
+	if (!p) {
+		printf("not a PCI device, so it has no physical name\n");
+		explain_cost(devname, dev->netdev->cost);
+		return 0;
+	}
+	if (dev->bios_name && !dev->location_source) {
+		printf("named by position, not by physical location\n");
+		return 0;
+	}
+	unparse_pci_name(pci_name, sizeof(pci_name), p->pci_dev);
+	printf("PCI function: %s%s\n", pci_name,
+	       p->is_sriov_virtual_function ? " (SR-IOV VF)" : "");
+	explain_slot(state, p);
+	if (p->physical_slot == 0)
+		explain_part(dev, "location", embedded_order, dev->location_source);
+	else if (p->physical_slot < PHYSICAL_SLOT_UNKNOWN)
+		explain_part(dev, "port", p->is_sriov_virtual_function ? vf_port_order : port_order,
+			     dev->port_source);
+	explain_part(dev, "interface", interface_order, dev->interface_source);
+	explain_cost(pci_name, p->cost);
+	if (p->pf)
+		explain_cost("its PF", p->pf->cost);
+	explain_cost(devname, dev->netdev->cost);
+	return 0;
+}
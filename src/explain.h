@@ -0,0 +1,12 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef EXPLAIN_H_INCLUDED
+#define EXPLAIN_H_INCLUDED
+
+/* Print where each part of devname's name came from, for --explain */
+extern int explain_bios_device(void *cookie, const char *devname);
+
+#endif /* EXPLAIN_H_INCLUDED */
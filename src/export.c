@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * --export prints every attribute of one device as KEY=value lines, for
+ * a udev rule to IMPORT{program} in one run instead of asking for each
+ * with its own PROGRAM.  Attributes that are unknown, or that aren't
+ * part of the name, are left out rather than printed empty.
+ */
+#include <stdio.h>
+#include "libbiosdevname.h"
+#include "export.h"
+
+static const char *name_sources[] = {
+	[NAME_SOURCE_NONE]		= NULL,
+	[NAME_SOURCE_DRIVER_PORT]	= "driver",
+	[NAME_SOURCE_SYSFS_INDEX]	= "sysfs",
+	[NAME_SOURCE_SMBIOS_INSTANCE]	= "smbios",
+	[NAME_SOURCE_EMBEDDED_INDEX]	= "order",
+	[NAME_SOURCE_SLOT]		= "slot",
+	[NAME_SOURCE_VPD_PORT]		= "vpd",
+	[NAME_SOURCE_INDEX_IN_SLOT]	= "order",
+	[NAME_SOURCE_PF_INDEX_IN_SLOT]	= "pf",
+	[NAME_SOURCE_DRIVER_PFI]	= "driver",
+	[NAME_SOURCE_VF_INDEX]		= "sriov",
+	[NAME_SOURCE_VPD_PFI]		= "vpd",
+};
+
+static const char *slot_sources[] = {
+	[SLOT_SOURCE_NONE]	= NULL,
+	[SLOT_SOURCE_SMBIOS]	= "smbios",
+	[SLOT_SOURCE_PCIE]	= "pcie",
+	[SLOT_SOURCE_PIRQ]	= "pirq",
+	[SLOT_SOURCE_VPD]	= "vpd",
+	[SLOT_SOURCE_PF]	= "pf",
+};
+
+/* What a SLOT_SOURCE_* is called, or NULL */
+const char *slot_source_name(int source)
+{
+	if (source > 0 && source < (int)(sizeof(slot_sources)/sizeof(slot_sources[0])))
+		return slot_sources[source];
+	return NULL;
+}
+
+static void export_number(FILE *fp, const char *key, int value)
+{
+	if (value >= 0)
+		fprintf(fp, "BIOSDEVNAME_%s=%d\n", key, value);
+}
+
+static void export_source(FILE *fp, const char *key, const char *sources[], int count, int source)
+{
+	if (source > 0 && source < count && sources[source])
+		fprintf(fp, "BIOSDEVNAME_%s=%s\n", key, sources[source]);
+}
+
+/* Returns 2, like a failed lookup, when the state doesn't have devname */
+int export_bios_device(FILE *fp, void *cookie, const char *devname)
+{
+	const struct libbiosdevname_device *d;
+
+	d = get_bios_device(cookie, devname);
+	if (!d)
+		return 2;
+	if (d->bios_name)
+		fprintf(fp, "BIOSDEVNAME_NAME=%s\n", d->bios_name);
+	if (d->flags & BIOS_DEVICE_DUPLICATE)
+		fprintf(fp, "BIOSDEVNAME_DUPLICATE=1\n");
+	if (d->pci_domain >= 0)
+		fprintf(fp, "BIOSDEVNAME_PCI=%04x:%02x:%02x.%x\n",
+			d->pci_domain, d->pci_bus, d->pci_device, d->pci_function);
+	export_number(fp, "SLOT", d->slot);
+	if (d->slot >= 0)
+		fprintf(fp, "BIOSDEVNAME_EMBEDDED=%d\n", !!(d->flags & BIOS_DEVICE_EMBEDDED));
+	/* what the location, p<slot> or the embedded NIC's number, rests on */
+	if (d->location_source == NAME_SOURCE_SLOT)
+		export_source(fp, "SOURCE", slot_sources,
+			      sizeof(slot_sources)/sizeof(slot_sources[0]), d->slot_source);
+	else
+		export_source(fp, "SOURCE", name_sources,
+			      sizeof(name_sources)/sizeof(name_sources[0]), d->location_source);
+	export_number(fp, "PORT", d->port);
+	export_source(fp, "PORT_SOURCE", name_sources, sizeof(name_sources)/sizeof(name_sources[0]),
+		      d->port_source);
+	export_number(fp, "PFI", d->pfi);
+	export_source(fp, "PFI_SOURCE", name_sources, sizeof(name_sources)/sizeof(name_sources[0]),
+		      d->interface_source);
+	export_number(fp, "VF", d->vf_index);
+	if (d->flags & BIOS_DEVICE_SRIOV_PF)
+		fprintf(fp, "BIOSDEVNAME_SRIOV_PF=1\n");
+	return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef EXPORT_H_INCLUDED
+#define EXPORT_H_INCLUDED
+
+#include <stdio.h>
+
+/* Print what is known about devname as udev KEY=value properties */
+extern int export_bios_device(FILE *fp, void *cookie, const char *devname);
+
+/* What a SLOT_SOURCE_* is called, or NULL */
+extern const char *slot_source_name(int source);
+
+#endif /* EXPORT_H_INCLUDED */
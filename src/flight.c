@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * udev runs biosdevname for many interfaces at once, and each would
+ * read the same config space, VPD and SMBIOS.  Instead, whoever takes
+ * RUN_DIR/lock first does the discovery and publishes every name it
+ * found in RUN_DIR/flight.  The others wait for the lock and take their
+ * name from that table, provided it was published after they started
+ * waiting and lists their interface with the same ifindex.  Whoever
+ * isn't listed waits for the lock to itself: by then someone else may
+ * have named everything, and if not, it does so for everyone still
+ * waiting.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/file.h>
+#include "bios_device.h"
+#include "state.h"
+#include "libbiosdevname.h"
+#include "runfiles.h"
+#include "nametable.h"
+#include "flight.h"
+
+#define FLIGHT_WAIT_MS 5000	/* for one discovery, VPD included */
+#define FLIGHT_POLL_MS 10
+
+static int lock_fd = -1;
+
+/*
+ * flock() that gives up at deadline, a name_table_now() time.  It polls
+ * rather than arming a timer, so the caller's signals are left alone.
+ */
+static int wait_lock(int fd, int op, unsigned long long deadline)
+{
+	while (flock(fd, op | LOCK_NB)) {
+		if (errno != EWOULDBLOCK || name_table_now() >= deadline)
+			return 1;
+		usleep(FLIGHT_POLL_MS * 1000);
+	}
+	return 0;
+}
+
+/* Returns 0 and sets *name (NULL when it has none) if the table has devname */
+static int table_lookup(const struct libbiosdevname_config *config, const char *devname,
+			unsigned long long since, char **name)
+{
+	const struct name_table_entry *e;
+	struct name_table *t;
+	char key[256];
+	int cur, rc = 1;
+
+	t = name_table_open(config->sysroot, "flight");
+	if (!t)
+		return 1;
+	if (run_key(key, sizeof(key), config) ||
+	    strncmp(t->hdr->key, key, sizeof(t->hdr->key)) || t->hdr->published < since)
+		goto out;
+	e = name_table_find(t, devname);
+	/* the same name may belong to another interface by now */
+	if (!e || read_eth_ifindex(config->sysroot, devname, &cur) || cur != e->ifindex)
+		goto out;
+	if (e->bios_name[0] && !(e->flags & NAME_ENTRY_DUPLICATE))
+		*name = strdup(e->bios_name);
+	rc = 0;
+out:
+	name_table_close(t);
+	return rc;
+}
+
+/*
+ * Decide who discovers devname's name.  Returns FLIGHT_HIT with *name
+ * set when another process just did, or tells the caller to do it
+ * itself: FLIGHT_LEAD when nobody else was busy, FLIGHT_LEAD_ALL when
+ * others are waiting and need every name, and FLIGHT_ALONE when the
+ * lock can't be had and nothing will be published.
+ */
+int flight_lookup(const struct libbiosdevname_config *config, const char *devname, char **name)
+{
+	struct libbiosdevname_config c;
+	char path[PATH_MAX];
+	unsigned long long since, deadline;
+	int fd;
+
+	*name = NULL;
+	config_defaults(&c, config);
+	if (run_mkdir(c.sysroot, NULL))
+		return FLIGHT_ALONE;
+	run_path(path, sizeof(path), c.sysroot, "lock");
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return FLIGHT_ALONE;
+	/* before trying, so a leader that publishes in between still counts */
+	since = name_table_now();
+	if (!flock(fd, LOCK_EX | LOCK_NB)) {
+		lock_fd = fd;
+		return FLIGHT_LEAD;
+	}
+	if (errno != EWOULDBLOCK)
+		goto alone;
+	deadline = since + FLIGHT_WAIT_MS * 1000000ULL;
+	/* waiters read the table side by side once the leader is done */
+	if (wait_lock(fd, LOCK_SH, deadline))
+		goto alone;
+	if (!table_lookup(&c, devname, since, name))
+		goto hit;
+	/*
+	 * A leader that only named its own slot left devname out.  Queue
+	 * for the lock rather than racing the other readers for it, which
+	 * can't be won while any of them still holds it shared.
+	 */
+	if (wait_lock(fd, LOCK_EX, deadline))
+		goto alone;
+	if (!table_lookup(&c, devname, since, name))
+		goto hit;
+	lock_fd = fd;
+	return FLIGHT_LEAD_ALL;
+hit:
+	close(fd);
+	return FLIGHT_HIT;
+alone:
+	close(fd);
+	return FLIGHT_ALONE;
+}
+
+/* Publish what a leader found, or just let the others go when cookie is NULL */
+void flight_publish(void *cookie)
+{
+	if (lock_fd < 0)
+		return;
+	if (cookie)
+		name_table_publish(cookie, "flight", 0);
+	close(lock_fd);
+	lock_fd = -1;
+}
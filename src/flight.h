@@ -0,0 +1,25 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef FLIGHT_H_INCLUDED
+#define FLIGHT_H_INCLUDED
+
+#include "libbiosdevname.h"
+
+/*
+ * These coordinate biosdevname processes with each other through files
+ * under RUN_DIR, and keep one lock per process.  They are meant for the
+ * command line, not for threads.
+ */
+enum flight_role {
+	FLIGHT_HIT,		/* another process just named it */
+	FLIGHT_LEAD,		/* name it and publish, nobody is waiting */
+	FLIGHT_LEAD_ALL,	/* others are waiting, name everything */
+	FLIGHT_ALONE,		/* name it, nothing gets published */
+};
+extern int flight_lookup(const struct libbiosdevname_config *config, const char *devname, char **name);
+extern void flight_publish(void *cookie);
+
+#endif /* FLIGHT_H_INCLUDED */
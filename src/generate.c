@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Turn one discovery into systemd .link files or a udev rules file that
+ * name every interface by its permanent MAC address or PCI address, so
+ * later boots on the same hardware don't run biosdevname at all.  Each
+ * file starts with a fingerprint of every match and name written.  When
+ * run again, nothing is touched unless the fingerprint changed, and
+ * files written before that no longer apply are removed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <net/if.h>
+#include "libbiosdevname.h"
+#include "runfiles.h"
+#include "generate.h"
+
+#define GENERATED_MARK	"# Written by biosdevname"
+#define LINK_PREFIX	"70-biosdevname-"
+#define LINK_SUFFIX	".link"
+
+struct generated {
+	char file[IFNAMSIZ + sizeof(LINK_PREFIX) + sizeof(LINK_SUFFIX)];
+	char match[128];
+	const char *name;
+};
+
+/* FNV-1a, 64 bits */
+static void fingerprint_add(unsigned long long *h, const char *s)
+{
+	while (*s) {
+		*h ^= (unsigned char)*s++;
+		*h *= 1099511628211ULL;
+	}
+}
+
+static int shares_bus_info(void *cookie, const struct libbiosdevname_device *d)
+{
+	const struct libbiosdevname_device *o;
+	int n = 0;
+
+	for (o = first_bios_device(cookie); o; o = next_bios_device(cookie, o)) {
+		if (!strcmp(o->bus_info, d->bus_info))
+			n++;
+	}
+	return n > 1;
+}
+
+/*
+ * A VF's MAC address can change on every boot, and several interfaces
+ * can share one PCI function; returns nonzero when d can't be matched.
+ */
+static int link_match(char *buf, int size, void *cookie, const struct libbiosdevname_device *d)
+{
+	const unsigned char *a = d->perm_addr;
+
+	if (a && !(d->flags & BIOS_DEVICE_SRIOV_VF))
+		snprintf(buf, size, "PermanentMACAddress=%02x:%02x:%02x:%02x:%02x:%02x\n",
+			 a[0], a[1], a[2], a[3], a[4], a[5]);
+	else if (d->bus_info[0] && !shares_bus_info(cookie, d))
+		snprintf(buf, size, "Path=pci-%s\n", d->bus_info);
+	else
+		return 1;
+	return 0;
+}
+
+static int rule_match(char *buf, int size, void *cookie, const struct libbiosdevname_device *d)
+{
+	if (!d->bus_info[0])
+		return 1;
+	if (!shares_bus_info(cookie, d))
+		snprintf(buf, size, "KERNELS==\"%s\"", d->bus_info);
+	else if (d->dev_port >= 0)
+		snprintf(buf, size, "KERNELS==\"%s\", ATTR{dev_port}==\"%d\"",
+			 d->bus_info, d->dev_port);
+	else
+		return 1;
+	return 0;
+}
+
+/* Returns the number of entries, or -1; the fingerprint covers them all */
+static int collect(void *cookie, int links, struct generated **entries,
+		   unsigned long long *fingerprint)
+{
+	const struct libbiosdevname_device *d;
+	struct generated *e;
+	int n = 0, rc;
+
+	for (d = first_bios_device(cookie); d; d = next_bios_device(cookie, d))
+		n++;
+	*entries = e = calloc(n ? n : 1, sizeof(*e));
+	if (!e)
+		return -1;
+	*fingerprint = 14695981039346656037ULL;
+	for (d = first_bios_device(cookie); d; d = next_bios_device(cookie, d)) {
+		if (!d->bios_name || !d->kernel_name)
+			continue;
+		if (links)
+			rc = link_match(e->match, sizeof(e->match), cookie, d);
+		else
+			rc = rule_match(e->match, sizeof(e->match), cookie, d);
+		if (rc) {
+			fprintf(stderr, "Cannot tell %s apart from other interfaces, not naming it %s\n",
+				d->kernel_name, d->bios_name);
+			continue;
+		}
+		e->name = d->bios_name;
+		snprintf(e->file, sizeof(e->file), "%s%s%s", LINK_PREFIX, e->name, LINK_SUFFIX);
+		fingerprint_add(fingerprint, e->match);
+		fingerprint_add(fingerprint, e->name);
+		e++;
+	}
+	return e - *entries;
+}
+
+static int is_generated(const char *path)
+{
+	char line[128];
+
+	return !read_first_line(path, line, sizeof(line)) &&
+		!strncmp(line, GENERATED_MARK, strlen(GENERATED_MARK));
+}
+
+/* Remove the .link files written before that aren't in entries */
+static int remove_stale_links(const char *dir, const struct generated *entries, int n)
+{
+	char path[PATH_MAX];
+	struct dirent *dent;
+	size_t len;
+	DIR *d;
+	int i, removed = 0;
+
+	d = opendir(dir);
+	if (!d)
+		return 0;
+	while ((dent = readdir(d)) != NULL) {
+		len = strlen(dent->d_name);
+		if (strncmp(dent->d_name, LINK_PREFIX, strlen(LINK_PREFIX)) ||
+		    len < strlen(LINK_SUFFIX) ||
+		    strcmp(dent->d_name + len - strlen(LINK_SUFFIX), LINK_SUFFIX))
+			continue;
+		for (i=0; i<n; i++) {
+			if (!strcmp(dent->d_name, entries[i].file))
+				break;
+		}
+		snprintf(path, sizeof(path), "%s/%s", dir, dent->d_name);
+		if (i == n && is_generated(path) && !unlink(path))
+			removed++;
+	}
+	closedir(d);
+	return removed;
+}
+
+int write_links(void *cookie, const char *dir)
+{
+	struct generated *entries;
+	unsigned long long fingerprint;
+	char header[128], line[128], path[PATH_MAX], tmp[PATH_MAX];
+	int i, n, written = 0, removed, rc = 0;
+	FILE *fp;
+
+	n = collect(cookie, 1, &entries, &fingerprint);
+	if (n < 0)
+		return 1;
+	snprintf(header, sizeof(header), "%s --write-links, fingerprint %016llx",
+		 GENERATED_MARK, fingerprint);
+	removed = remove_stale_links(dir, entries, n);
+	for (i=0; i<n; i++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, entries[i].file);
+		if (!read_first_line(path, line, sizeof(line)) && !strcmp(line, header))
+			continue;
+		fp = run_create(path, tmp, sizeof(tmp));
+		if (!fp) {
+			perror(path);
+			rc = 1;
+			continue;
+		}
+		fprintf(fp, "%s\n# Run it again when the network hardware changes.\n\n", header);
+		fprintf(fp, "[Match]\n%s\n[Link]\nName=%s\n", entries[i].match, entries[i].name);
+		if (run_commit(fp, tmp, path)) {
+			perror(path);
+			rc = 1;
+			continue;
+		}
+		written++;
+	}
+	printf("fingerprint %016llx: %d written, %d removed\n", fingerprint, written, removed);
+	free(entries);
+	return rc;
+}
+
+int write_rules(void *cookie, const char *path)
+{
+	struct generated *entries;
+	unsigned long long fingerprint;
+	char header[128], line[128], tmp[PATH_MAX];
+	int i, n, written = 0, rc = 0;
+	FILE *fp;
+
+	n = collect(cookie, 0, &entries, &fingerprint);
+	if (n < 0)
+		return 1;
+	snprintf(header, sizeof(header), "%s --write-rules, fingerprint %016llx",
+		 GENERATED_MARK, fingerprint);
+	if (read_first_line(path, line, sizeof(line)) || strcmp(line, header)) {
+		fp = run_create(path, tmp, sizeof(tmp));
+		if (!fp) {
+			perror(path);
+			free(entries);
+			return 1;
+		}
+		fprintf(fp, "%s\n# Run it again when the network hardware changes.\n\n", header);
+		for (i=0; i<n; i++)
+			fprintf(fp, "SUBSYSTEM==\"net\", ACTION==\"add\", %s, NAME=\"%s\"\n",
+				entries[i].match, entries[i].name);
+		if (run_commit(fp, tmp, path)) {
+			perror(path);
+			rc = 1;
+		} else
+			written = n;
+	}
+	printf("fingerprint %016llx: %d written\n", fingerprint, written);
+	free(entries);
+	return rc;
+}
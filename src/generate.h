@@ -0,0 +1,13 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef GENERATE_H_INCLUDED
+#define GENERATE_H_INCLUDED
+
+/* Write static configuration that gives every device its BIOS name */
+extern int write_links(void *cookie, const char *dir);
+extern int write_rules(void *cookie, const char *path);
+
+#endif /* GENERATE_H_INCLUDED */
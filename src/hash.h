@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef HASH_H_INCLUDED
+#define HASH_H_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+
+/*
+ * Simple chained hash table.  Each bucket is a list_head, so entries
+ * just embed a struct list_head and use the usual list.h helpers.
+ * Entries added with list_add_tail() keep their insertion order within
+ * a bucket.
+ */
+struct hash_table {
+	struct list_head *buckets;
+	unsigned int size;	/* always a power of two, 0 if unallocated */
+};
+
+/* FNV-1a over at most len bytes of a NUL-terminated string */
+static inline unsigned int hash_strn(const char *s, size_t len)
+{
+	unsigned int h = 2166136261U;
+	while (len-- && *s) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static inline unsigned int hash_int(unsigned int v)
+{
+	v ^= v >> 16;
+	v *= 0x45d9f3bU;
+	v ^= v >> 16;
+	return v;
+}
+
+/* Size the table for roughly one entry per bucket */
+static inline int hash_table_init(struct hash_table *t, unsigned int nentries)
+{
+	unsigned int i, size = 16;
+
+	while (size < nentries)
+		size <<= 1;
+	t->buckets = malloc(size * sizeof(*t->buckets));
+	if (!t->buckets) {
+		t->size = 0;
+		return 1;
+	}
+	for (i=0; i<size; i++)
+		INIT_LIST_HEAD(&t->buckets[i]);
+	t->size = size;
+	return 0;
+}
+
+static inline void hash_table_free(struct hash_table *t)
+{
+	free(t->buckets);
+	t->buckets = NULL;
+	t->size = 0;
+}
+
+static inline struct list_head *hash_bucket(const struct hash_table *t, unsigned int hash)
+{
+	return &t->buckets[hash & (t->size - 1)];
+}
+
+#endif /* HASH_H_INCLUDED */
@@ -0,0 +1,330 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Keep a resident state up to date from kernel uevents instead of
+ * rebuilding it.  Each event touches a few slots; only the devices in
+ * those slots are renamed, and only names that actually changed are
+ * reported.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include "bios_device.h"
+#include "state.h"
+#include "libbiosdevname.h"
+#include "naming_policy.h"
+#include "pci.h"
+#include "eths.h"
+
+struct uevent {
+	const char *action;
+	const char *subsystem;
+	const char *interface;
+	const char *devpath_old;
+	const char *pci_slot_name;
+};
+
+static const char *field(const char *s, const char *key)
+{
+	size_t len = strlen(key);
+
+	if (strncmp(s, key, len) || s[len] != '=')
+		return NULL;
+	return s + len + 1;
+}
+
+/* NUL separated KEY=value pairs, after an optional action@devpath header */
+static void parse_uevent(struct uevent *ev, const char *buf, size_t len)
+{
+	const char *s, *end = buf + len, *v;
+
+	memset(ev, 0, sizeof(*ev));
+	for (s=buf; s<end; s+=strlen(s)+1) {
+		if ((v = field(s, "ACTION")) != NULL)
+			ev->action = v;
+		else if ((v = field(s, "SUBSYSTEM")) != NULL)
+			ev->subsystem = v;
+		else if ((v = field(s, "INTERFACE")) != NULL)
+			ev->interface = v;
+		else if ((v = field(s, "DEVPATH_OLD")) != NULL)
+			ev->devpath_old = v;
+		else if ((v = field(s, "PCI_SLOT_NAME")) != NULL)
+			ev->pci_slot_name = v;
+	}
+}
+
+static const char *effective_name(const struct bios_device *dev)
+{
+	return dev->duplicate ? NULL : dev->bios_name;
+}
+
+static void touch(struct slot_set *slots, const struct bios_device *dev)
+{
+	if (dev->pcidev)
+		slot_set_add(slots, dev->pcidev->physical_slot);
+}
+
+static void drop_bios_device(struct bios_device *dev, bios_name_changed_fn changed, void *arg)
+{
+	if (effective_name(dev))
+		changed(dev->netdev->kernel_name, NULL, arg);
+	remove_bios_device(dev);
+}
+
+static void net_remove(struct libbiosdevname_state *state, const char *name,
+		       struct slot_set *slots, bios_name_changed_fn changed, void *arg)
+{
+	struct bios_device *dev;
+	struct network_device *n;
+
+	dev = find_bios_device_by_name(state, name);
+	if (dev) {
+		touch(slots, dev);
+		drop_bios_device(dev, changed, arg);
+	}
+	n = find_eth(state, name);
+	if (n)
+		free_eth(state, n);
+}
+
+static void net_add(struct libbiosdevname_state *state, const char *name,
+		    struct slot_set *slots, bios_name_changed_fn changed, void *arg)
+{
+	struct bios_device *dev;
+	struct network_device *n;
+
+	/* a missed remove leaves the old interface behind */
+	net_remove(state, name, slots, changed, arg);
+	n = get_eth(state, name);
+	if (!n)
+		return;
+	hash_eth(state, n);
+	dev = match_eth(state, n);
+	if (dev)
+		touch(slots, dev);
+}
+
+static void net_move(struct libbiosdevname_state *state, const char *name,
+		     const char *devpath_old, struct slot_set *slots,
+		     bios_name_changed_fn changed, void *arg)
+{
+	struct bios_device *dev;
+	struct network_device *n;
+	const char *old;
+	char oldname[IFNAMSIZ];
+
+	old = strrchr(devpath_old, '/');
+	old = old ? old+1 : devpath_old;
+	n = find_eth(state, old);
+	if (!n) {
+		net_add(state, name, slots, changed, arg);
+		return;
+	}
+	strncpy(oldname, old, sizeof(oldname)-1);
+	oldname[sizeof(oldname)-1] = '\0';
+	dev = find_bios_device_by_name(state, oldname);
+	if (dev)
+		unhash_bios_device(dev);
+	rename_eth(state, n, name);
+	if (!dev)
+		return;
+	hash_bios_device(state, dev);
+	if (effective_name(dev)) {
+		changed(oldname, NULL, arg);
+		changed(n->kernel_name, dev->bios_name, arg);
+	}
+}
+
+/* A function and its VFs lost, their interfaces stay behind unmatched */
+static int is_on_function(const struct bios_device *dev, const struct pci_device *p,
+			  const struct pci_vf *vf)
+{
+	if (!dev->pcidev)
+		return 0;
+	if (vf)
+		return vf->dev && dev->pcidev == vf->dev;
+	return dev->pcidev == p || dev->pcidev->pf == p;
+}
+
+static void pci_remove(struct libbiosdevname_state *state, const char *pci_name,
+		       struct slot_set *slots, bios_name_changed_fn changed, void *arg)
+{
+	struct bios_device *dev, *tmp;
+	struct network_device **orphans = NULL, **o;
+	struct pci_device *p;
+	struct pci_vf *vf = NULL;
+	unsigned int i, n = 0;
+
+	p = find_dev_by_pci_name(state, pci_name);
+	if (!p)
+		vf = find_vf_by_pci_name(state, pci_name);
+	if (!p && !vf)
+		return;
+	list_for_each_entry_safe(dev, tmp, &state->bios_devices, node) {
+		if (!is_on_function(dev, p, vf))
+			continue;
+		o = realloc(orphans, (n+1) * sizeof(*orphans));
+		if (o) {
+			orphans = o;
+			orphans[n++] = dev->netdev;
+		}
+		touch(slots, dev);
+		drop_bios_device(dev, changed, arg);
+	}
+	pci_hotplug_remove(state, pci_name, slots);
+	for (i=0; i<n; i++)
+		match_eth(state, orphans[i]);
+	free(orphans);
+}
+
+/* Interfaces that showed up before their function was known were matched as unknown */
+static void pci_add(struct libbiosdevname_state *state, const char *pci_name,
+		    struct slot_set *slots)
+{
+	struct bios_device *dev;
+	struct network_device *n;
+
+	if (pci_hotplug_add(state, pci_name, slots))
+		return;
+	for_each_net_device_by_bus_info(n, state, pci_name) {
+		if (netdev_is_claimed(n))
+			continue;
+		dev = find_bios_device_by_name(state, n->kernel_name);
+		if (dev && dev->netdev == n)
+			remove_bios_device(dev);
+		dev = match_eth(state, n);
+		if (dev)
+			touch(slots, dev);
+	}
+}
+
+struct renamed {
+	struct bios_device *dev;
+	char *old;		/* previous bios_name */
+	int was_named;		/* and whether it was used */
+};
+
+static int cmp_renamed(const void *a, const void *b)
+{
+	const struct renamed *x = a, *y = b;
+
+	if (!x->dev->bios_name || !y->dev->bios_name)
+		return !x->dev->bios_name - !y->dev->bios_name;
+	return strcmp(x->dev->bios_name, y->dev->bios_name);
+}
+
+/*
+ * Name the devices in the touched slots again.  Two devices can only
+ * share a name if they share a slot, so duplicates are found within
+ * the group.
+ */
+static void rename_slots(struct libbiosdevname_state *state, const struct slot_set *slots,
+			 bios_name_changed_fn changed, void *arg)
+{
+	struct bios_device *dev;
+	struct renamed *group;
+	const char *name;
+	unsigned int i, n = 0;
+
+	list_for_each_entry(dev, &state->bios_devices, node) {
+		if (dev->pcidev && slot_set_has(slots, dev->pcidev->physical_slot))
+			n++;
+	}
+	if (!n)
+		return;
+	group = calloc(n, sizeof(*group));
+	if (!group)
+		return;
+	i = 0;
+	list_for_each_entry(dev, &state->bios_devices, node) {
+		if (!dev->pcidev || !slot_set_has(slots, dev->pcidev->physical_slot))
+			continue;
+		group[i].dev = dev;
+		group[i].old = dev->bios_name;
+		group[i].was_named = !dev->duplicate && dev->bios_name;
+		dev->bios_name = NULL;
+		dev->duplicate = 0;
+		dev->location_source = NAME_SOURCE_NONE;
+		dev->port_source = NAME_SOURCE_NONE;
+		dev->interface_source = NAME_SOURCE_NONE;
+		name_physical(dev, state->config.prefix);
+		i++;
+	}
+
+	qsort(group, n, sizeof(*group), cmp_renamed);
+	for (i=1; i<n; i++) {
+		if (group[i].dev->bios_name && group[i].dev->bios_name[0] &&
+		    !cmp_renamed(&group[i-1], &group[i])) {
+			group[i-1].dev->duplicate = 1;
+			group[i].dev->duplicate = 1;
+		}
+	}
+
+	for (i=0; i<n; i++) {
+		name = effective_name(group[i].dev);
+		if (!name != !group[i].was_named ||
+		    (name && strcmp(name, group[i].old)))
+			changed(group[i].dev->netdev->kernel_name, name, arg);
+		free(group[i].old);
+	}
+	free(group);
+}
+
+/*
+ * Apply one uevent, as read from a NETLINK_KOBJECT_UEVENT socket, to a
+ * state from setup_bios_devices().  changed() is called with each
+ * interface whose name changed, and a NULL bios_name when it no longer
+ * has one.  Returns 1 when the event was applied and 0 when it had
+ * nothing to do with network interfaces.  Only the physical policy can
+ * be updated this way: with no state, or a state using another policy,
+ * it returns -1 with errno set to EINVAL.
+ */
+int update_bios_devices(void *cookie, const char *uevent, size_t len,
+			bios_name_changed_fn changed, void *arg)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct slot_set slots;
+	struct uevent ev;
+
+	if (!state || state->config.namingpolicy != physical) {
+		errno = EINVAL;
+		return -1;
+	}
+	parse_uevent(&ev, uevent, len);
+	if (!ev.action || !ev.subsystem)
+		return 0;
+
+	memset(&slots, 0, sizeof(slots));
+	/* a "p" prefix can make embedded names look like slot names */
+	if (state->config.prefix[0] == 'p')
+		slots.all = 1;
+
+	if (!strcmp(ev.subsystem, "net") && ev.interface) {
+		if (!strcmp(ev.action, "add"))
+			net_add(state, ev.interface, &slots, changed, arg);
+		else if (!strcmp(ev.action, "remove"))
+			net_remove(state, ev.interface, &slots, changed, arg);
+		else if (!strcmp(ev.action, "move") && ev.devpath_old)
+			net_move(state, ev.interface, ev.devpath_old, &slots, changed, arg);
+		else
+			return 0;
+	} else if (!strcmp(ev.subsystem, "pci") && ev.pci_slot_name) {
+		if (!strcmp(ev.action, "add"))
+			pci_add(state, ev.pci_slot_name, &slots);
+		else if (!strcmp(ev.action, "remove"))
+			pci_remove(state, ev.pci_slot_name, &slots, changed, arg);
+		else
+			return 0;
+	} else
+		return 0;
+
+	if (slots.all || slots.n)
+		rename_slots(state, &slots, changed, arg);
+	fill_bios_devices_info(state);
+	return 1;
+}
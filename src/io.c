@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "io.h"
+#include "profile.h"
+#include "trace.h"
+
+int io_open(const char *path, int flags)
+{
+	unsigned long long t = trace_now();
+	int fd = open(path, flags);
+
+	profile_io(IO_OPEN, 1);
+	trace_io("open", t, path, -1);
+	return fd;
+}
+
+ssize_t io_read(int fd, void *buf, size_t count)
+{
+	unsigned long long t = trace_now();
+	ssize_t len = read(fd, buf, count);
+
+	profile_io(IO_READ, 1);
+	if (len > 0)
+		profile_io(IO_BYTES, len);
+	trace_io("read", t, NULL, len);
+	return len;
+}
+
+ssize_t io_readlink(const char *path, char *buf, size_t bufsize)
+{
+	unsigned long long t = trace_now();
+	ssize_t len = readlink(path, buf, bufsize);
+
+	profile_io(IO_READLINK, 1);
+	trace_io("readlink", t, path, -1);
+	return len;
+}
+
+int io_socket(int domain, int type, int protocol)
+{
+	unsigned long long t = trace_now();
+	int fd = socket(domain, type, protocol);
+
+	profile_io(IO_SOCKET, 1);
+	trace_io("socket", t, NULL, -1);
+	return fd;
+}
+
+int io_ioctl(int fd, unsigned long request, void *arg)
+{
+	unsigned long long t = trace_now();
+	int rc = ioctl(fd, request, arg);
+
+	profile_io(IO_IOCTL, 1);
+	trace_io("ioctl", t, NULL, -1);
+	return rc;
+}
+
+int io_scandir(const char *dir, struct dirent ***namelist,
+	       int (*filter)(const struct dirent *),
+	       int (*compar)(const struct dirent **, const struct dirent **))
+{
+	unsigned long long t = trace_now();
+	int n = scandir(dir, namelist, filter, compar);
+
+	profile_io(IO_SCANDIR, 1);
+	trace_io("scandir", t, dir, -1);
+	return n;
+}
+
+FILE *io_fopen(const char *path, const char *mode)
+{
+	unsigned long long t = trace_now();
+	FILE *fp = fopen(path, mode);
+
+	profile_io(IO_OPEN, 1);
+	trace_io("fopen", t, path, -1);
+	return fp;
+}
+
+size_t io_fread(void *buf, size_t size, size_t n, FILE *fp)
+{
+	unsigned long long t = trace_now();
+	size_t len = fread(buf, size, n, fp);
+
+	profile_io(IO_READ, 1);
+	profile_io(IO_BYTES, len * size);
+	trace_io("fread", t, NULL, len * size);
+	return len;
+}
+
+char *io_fgets(char *s, int size, FILE *fp)
+{
+	unsigned long long t = trace_now();
+	char *r = fgets(s, size, fp);
+	size_t len = r ? strlen(r) : 0;
+
+	profile_io(IO_READ, 1);
+	profile_io(IO_BYTES, len);
+	trace_io("fgets", t, NULL, len);
+	return r;
+}
+
+ssize_t io_getline(char **line, size_t *n, FILE *fp)
+{
+	unsigned long long t = trace_now();
+	ssize_t len = getline(line, n, fp);
+
+	profile_io(IO_READ, 1);
+	if (len > 0)
+		profile_io(IO_BYTES, len);
+	trace_io("getline", t, NULL, len);
+	return len;
+}
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef IO_H_INCLUDED
+#define IO_H_INCLUDED
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <dirent.h>
+
+/*
+ * Wrappers for the system calls that do biosdevname's hardware and
+ * sysfs I/O, so --profile can count them and --trace can time them.
+ * stdio reads count once per call, whatever the FILE buffering does
+ * underneath.
+ */
+extern int io_open(const char *path, int flags);
+extern ssize_t io_read(int fd, void *buf, size_t count);
+extern ssize_t io_readlink(const char *path, char *buf, size_t bufsize);
+extern int io_socket(int domain, int type, int protocol);
+extern int io_ioctl(int fd, unsigned long request, void *arg);
+extern int io_scandir(const char *dir, struct dirent ***namelist,
+		      int (*filter)(const struct dirent *),
+		      int (*compar)(const struct dirent **, const struct dirent **));
+extern FILE *io_fopen(const char *path, const char *mode);
+extern size_t io_fread(void *buf, size_t size, size_t n, FILE *fp);
+extern char *io_fgets(char *s, int size, FILE *fp);
+extern ssize_t io_getline(char **line, size_t *n, FILE *fp);
+
+#endif /* IO_H_INCLUDED */
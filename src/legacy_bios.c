@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include "legacy_bios.h"
+#include "state.h"
+#include "sysfs.h"
+#include "io.h"
+#include "dmidecode/types.h"
+#include "dmidecode/dmidecode.h"
+
+static void add_anchor(struct legacy_bios_area *area, int type, unsigned int offset)
+{
+	if (area->count >= LEGACY_BIOS_MAX_ANCHORS)
+		return;
+	area->anchor[area->count].type = type;
+	area->anchor[area->count].offset = offset;
+	area->count++;
+}
+
+/*
+ * Map 0xF0000-0xFFFFF once and note every $PIR, _SM_ and _DMI_ anchor
+ * on its 16-byte boundary, so the $PIR and SMBIOS code can share a
+ * single pass over it.
+ */
+struct legacy_bios_area *legacy_bios_scan(const char *sysroot)
+{
+	struct legacy_bios_area *area;
+	unsigned int offset;
+	void *mem;
+	int fd;
+	char efi[PATH_MAX], smbios[PATH_MAX], devmem[PATH_MAX];
+
+	/* UEFI systems with sysfs tables have nothing for us down there */
+	snprintf(efi, sizeof(efi), "%s/sys/firmware/efi", sysroot);
+	snprintf(smbios, sizeof(smbios), "%s%s", sysroot, SYSFS_TABLE_SMBIOS);
+	if (access(efi, F_OK) == 0 && access(smbios, F_OK) == 0)
+		return NULL;
+
+	snprintf(devmem, sizeof(devmem), "%s/dev/mem", sysroot);
+	fd = io_open(devmem, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	mem = mmap(0, LEGACY_BIOS_SIZE, PROT_READ, MAP_SHARED, fd, LEGACY_BIOS_BASE);
+	close(fd);
+	if (mem == MAP_FAILED)
+		return NULL;
+
+	area = malloc(sizeof(*area));
+	if (!area) {
+		munmap(mem, LEGACY_BIOS_SIZE);
+		return NULL;
+	}
+	memset(area, 0, sizeof(*area));
+	area->mem = mem;
+
+	for (offset = 0; offset <= LEGACY_BIOS_SIZE - 16; offset += 16) {
+		if (memcmp(area->mem+offset, "$PIR", 4) == 0)
+			add_anchor(area, ANCHOR_PIR, offset);
+		else if (memcmp(area->mem+offset, "_SM_", 4) == 0)
+			add_anchor(area, ANCHOR_SM, offset);
+		else if (memcmp(area->mem+offset, "_DMI_", 5) == 0)
+			add_anchor(area, ANCHOR_DMI, offset);
+	}
+	return area;
+}
+
+void legacy_bios_free(struct legacy_bios_area *area)
+{
+	if (!area)
+		return;
+	munmap(area->mem, LEGACY_BIOS_SIZE);
+	free(area);
+}
+
+/* Scan the area the first time anyone asks for it */
+struct legacy_bios_area *legacy_bios_area(struct libbiosdevname_state *state)
+{
+	if (!state->bios_area_scanned) {
+		state->bios_area_scanned = 1;
+		state->bios_area = legacy_bios_scan(state->config.sysroot);
+	}
+	return state->bios_area;
+}
@@ -0,0 +1,38 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef LEGACY_BIOS_H_INCLUDED
+#define LEGACY_BIOS_H_INCLUDED
+
+/* The legacy BIOS area holding the $PIR and SMBIOS/DMI anchors */
+#define LEGACY_BIOS_BASE	0xF0000L
+#define LEGACY_BIOS_SIZE	0x10000
+
+enum legacy_anchor_type {
+	ANCHOR_PIR,	/* "$PIR" PCI IRQ routing table */
+	ANCHOR_SM,	/* "_SM_" SMBIOS entry point */
+	ANCHOR_DMI,	/* "_DMI_" legacy DMI entry point */
+};
+
+#define LEGACY_BIOS_MAX_ANCHORS 16
+
+struct legacy_anchor {
+	int type;
+	unsigned int offset;	/* from LEGACY_BIOS_BASE */
+};
+
+struct legacy_bios_area {
+	unsigned char *mem;	/* LEGACY_BIOS_SIZE bytes, mapped read-only */
+	int count;
+	struct legacy_anchor anchor[LEGACY_BIOS_MAX_ANCHORS];
+};
+
+struct libbiosdevname_state;
+
+extern struct legacy_bios_area * legacy_bios_scan(const char *sysroot);
+extern void legacy_bios_free(struct legacy_bios_area *area);
+extern struct legacy_bios_area * legacy_bios_area(struct libbiosdevname_state *state);
+
+#endif /* LEGACY_BIOS_H_INCLUDED */
@@ -6,17 +6,108 @@
 #ifndef LIBBIOSDEVNAME_H_INCLUDED
 #define LIBBIOSDEVNAME_H_INCLUDED
 
+#include <stddef.h>
+
 enum namingpolicy {
 	physical,
 	all_ethN,
 };
 
-extern void * setup_bios_devices(int namingpolicy, const char *prefix);
+/*
+ * Everything a state is built from.  Zero it and set what differs from
+ * the defaults; the state keeps its own copy.  States share nothing, so
+ * each thread can set up, query and clean up its own.
+ */
+struct libbiosdevname_config {
+	int namingpolicy;
+	const char *prefix;		/* for embedded NICs, "em" when NULL */
+	int nopirq;			/* don't use the $PIR table */
+	unsigned int smver_mjr;		/* minimum SMBIOS version, 0.0 for any */
+	unsigned int smver_mnr;
+	const char *sysroot;		/* a --capture directory, NULL for this system */
+};
+/* Setup fails with ENAMETOOLONG when sysroot is too long to read below */
+
+/*
+ * Where each part of a physical name came from.  Within a part they are
+ * listed in the order they are tried.
+ */
+#define NAME_SOURCE_NONE		0
+#define NAME_SOURCE_DRIVER_PORT		1	/* dev_id of a multiport driver */
+#define NAME_SOURCE_SYSFS_INDEX		2	/* ACPI index in sysfs */
+#define NAME_SOURCE_SMBIOS_INSTANCE	3	/* SMBIOS type 41 instance */
+#define NAME_SOURCE_EMBEDDED_INDEX	4	/* order among embedded NICs */
+#define NAME_SOURCE_SLOT		5	/* the slot, see slot_source */
+#define NAME_SOURCE_VPD_PORT		6	/* Dell DCM VPD port */
+#define NAME_SOURCE_INDEX_IN_SLOT	7	/* order within the slot */
+#define NAME_SOURCE_PF_INDEX_IN_SLOT	8	/* a VF's PF order within the slot */
+#define NAME_SOURCE_DRIVER_PFI		9	/* VF index of a multiport driver */
+#define NAME_SOURCE_VF_INDEX		10	/* SR-IOV VF index */
+#define NAME_SOURCE_VPD_PFI		11	/* Dell DCM VPD partition */
+
+/* Where the slot came from, in the order they are tried */
+#define SLOT_SOURCE_NONE   0
+#define SLOT_SOURCE_SMBIOS 1
+#define SLOT_SOURCE_PCIE   2
+#define SLOT_SOURCE_PIRQ   3
+#define SLOT_SOURCE_VPD    4	/* embedded, like the VPD master function */
+#define SLOT_SOURCE_PF     5	/* a VF takes its PF's slot */
+
+#define BIOS_DEVICE_DUPLICATE	1	/* bios_name is shared, so not used */
+#define BIOS_DEVICE_EMBEDDED	2	/* slot 0 */
+#define BIOS_DEVICE_SRIOV_PF	4
+#define BIOS_DEVICE_SRIOV_VF	8
+
+/*
+ * What a state knows about one device.  Records point into the state,
+ * so they are only good until it is updated or cleaned up.  Numbers
+ * are -1 when unknown or not part of the name.
+ */
+struct libbiosdevname_device {
+	const char *kernel_name;
+	const char *bios_name;		/* NULL when it has none */
+	const char *bus_info;		/* from the driver, "" for none */
+	const char *driver;
+	const unsigned char *perm_addr;	/* 6 bytes, NULL when not reported */
+	const unsigned char *dev_addr;	/* 6 bytes */
+	int ifindex;
+	int dev_port;			/* tells apart interfaces of one function */
+	int pci_domain;			/* -1 when not on PCI */
+	int pci_bus;
+	int pci_device;
+	int pci_function;
+	int slot;			/* 0 for embedded */
+	int port;			/* after the prefix or p<slot> */
+	int pfi;			/* after the _ */
+	int vf_index;			/* SR-IOV VF index */
+	unsigned int flags;		/* BIOS_DEVICE_* */
+	int slot_source;		/* SLOT_SOURCE_* */
+	int location_source;		/* NAME_SOURCE_* for each part of bios_name */
+	int port_source;
+	int interface_source;
+};
+
+extern void * setup_bios_devices(const struct libbiosdevname_config *config);
+extern void * setup_bios_device(const struct libbiosdevname_config *config, const char *devname);
+/* Frees the state itself too; cookie can't be used again afterwards */
 extern void cleanup_bios_devices(void *cookie);
 extern char * kern_to_bios(void *cookie, const char *devname);
+extern char * ifindex_to_bios(void *cookie, int ifindex);
+extern const struct libbiosdevname_device * first_bios_device(void *cookie);
+extern const struct libbiosdevname_device * next_bios_device(void *cookie,
+			const struct libbiosdevname_device *prev);
+extern const struct libbiosdevname_device * get_bios_device(void *cookie, const char *devname);
 extern void unparse_bios_devices(void *cookie);
 extern void unparse_bios_device_by_name(void *cookie, const char *name);
 
+typedef void (*bios_name_changed_fn)(const char *kernel_name, const char *bios_name, void *arg);
+/* 1 when applied, 0 when ignored, -1 and EINVAL unless the policy is physical */
+extern int update_bios_devices(void *cookie, const char *uevent, size_t len,
+			       bios_name_changed_fn changed, void *arg);
+extern int rename_bios_devices(void *cookie, bios_name_changed_fn renamed, void *arg);
 
+extern void * open_published_names(const struct libbiosdevname_config *config);
+extern const char * published_kern_to_bios(void *names, const char *devname);
+extern void close_published_names(void *names);
 
 #endif /* LIBBIOSDEVNAME_H_INCLUDED */
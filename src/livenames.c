@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * RUN_DIR/names, kept current by --monitor and read by biosdevname -i.
+ * A process publishes it for as long as it holds RUN_DIR/monitor, so
+ * this is for the command line: one monitor per process.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include "bios_device.h"
+#include "eths.h"
+#include "state.h"
+#include "nametable.h"
+#include "runfiles.h"
+#include "livenames.h"
+
+static int monitor_fd = -1;
+
+/*
+ * Called by --monitor to keep RUN_DIR/names current.  Only one monitor
+ * publishes; returns nonzero when another one already does.
+ */
+int live_names_publish(void *cookie)
+{
+	struct libbiosdevname_state *state = cookie;
+	char path[PATH_MAX];
+
+	if (monitor_fd < 0) {
+		if (run_mkdir(state->config.sysroot, NULL))
+			return 1;
+		run_path(path, sizeof(path), state->config.sysroot, "monitor");
+		monitor_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (monitor_fd < 0)
+			return 1;
+		if (flock(monitor_fd, LOCK_EX | LOCK_NB)) {
+			close(monitor_fd);
+			monitor_fd = -1;
+			return 1;
+		}
+	}
+	return name_table_publish(state, "names", NAME_TABLE_MONITOR);
+}
+
+void live_names_stop(const struct libbiosdevname_config *config)
+{
+	struct libbiosdevname_config c;
+
+	if (monitor_fd < 0)
+		return;
+	config_defaults(&c, config);
+	name_table_unpublish(c.sysroot, "names");
+	close(monitor_fd);
+	monitor_fd = -1;
+}
+
+/*
+ * What an interface is called according to a running --monitor with the
+ * same options.  Returns 0 and sets *name (NULL when it has none) if the
+ * table lists devname with the ifindex it has now.
+ */
+int live_names_lookup(const struct libbiosdevname_config *config, const char *devname,
+		      char **name)
+{
+	const struct name_table_entry *e;
+	struct libbiosdevname_config c;
+	struct name_table *t;
+	char key[256];
+	int ifindex, rc = 1;
+
+	*name = NULL;
+	config_defaults(&c, config);
+	if (!monitor_running(c.sysroot))
+		return 1;
+	t = name_table_open(c.sysroot, "names");
+	if (!t)
+		return 1;
+	if (run_key(key, sizeof(key), &c) ||
+	    !(t->hdr->flags & NAME_TABLE_MONITOR) || strncmp(t->hdr->key, key, sizeof(t->hdr->key)))
+		goto out;
+	e = name_table_find(t, devname);
+	if (!e || read_eth_ifindex(c.sysroot, devname, &ifindex) || ifindex != e->ifindex)
+		goto out;
+	if (e->bios_name[0] && !(e->flags & NAME_ENTRY_DUPLICATE))
+		*name = strdup(e->bios_name);
+	rc = 0;
+out:
+	name_table_close(t);
+	return rc;
+}
@@ -0,0 +1,16 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef LIVENAMES_H_INCLUDED
+#define LIVENAMES_H_INCLUDED
+
+#include "libbiosdevname.h"
+
+extern int live_names_publish(void *cookie);
+extern void live_names_stop(const struct libbiosdevname_config *config);
+extern int live_names_lookup(const struct libbiosdevname_config *config, const char *devname,
+			     char **name);
+
+#endif /* LIVENAMES_H_INCLUDED */
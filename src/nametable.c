@@ -0,0 +1,287 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Names are published as a binary table in RUN_DIR that readers map and
+ * search in place, so asking for a name costs no discovery and no IPC.
+ * RUN_DIR/flight is what one discovery found, for the processes that
+ * waited on it.  RUN_DIR/names is kept current by --monitor, which holds
+ * RUN_DIR/monitor locked for as long as it does so (see livenames.c).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bios_device.h"
+#include "eths.h"
+#include "state.h"
+#include "libbiosdevname.h"
+#include "nametable.h"
+#include "runfiles.h"
+
+unsigned long long name_table_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_entries(const void *a, const void *b)
+{
+	const struct name_table_entry *x = a, *y = b;
+
+	return strcmp(x->kernel_name, y->kernel_name);
+}
+
+/* Tell whoever has the table open as fd mapped to map path again */
+static int set_superseded(int fd, uint32_t superseded)
+{
+	if (fd < 0)
+		return 0;
+	if (pwrite(fd, &superseded, sizeof(superseded),
+		   offsetof(struct name_table_header, superseded)) != sizeof(superseded))
+		return 1;
+	return 0;
+}
+
+int name_table_publish(const struct libbiosdevname_state *state, const char *file,
+		       unsigned int flags)
+{
+	struct name_table_header hdr;
+	struct name_table_entry *entries, *e;
+	struct bios_device *dev;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	unsigned int count = 0;
+	int old_fd, rc = 1;
+	FILE *fp;
+
+	list_for_each_entry(dev, &state->bios_devices, node)
+		if (dev->netdev)
+			count++;
+	entries = calloc(count ? count : 1, sizeof(*entries));
+	if (!entries)
+		return 1;
+	e = entries;
+	list_for_each_entry(dev, &state->bios_devices, node) {
+		if (!dev->netdev)
+			continue;
+		snprintf(e->kernel_name, sizeof(e->kernel_name), "%s", dev->netdev->kernel_name);
+		if (dev->bios_name)
+			snprintf(e->bios_name, sizeof(e->bios_name), "%s", dev->bios_name);
+		if (dev->netdev->drvinfo_valid)
+			snprintf(e->bus_info, sizeof(e->bus_info), "%s", dev->netdev->drvinfo.bus_info);
+		e->ifindex = dev->netdev->ifindex;
+		if (dev->duplicate)
+			e->flags |= NAME_ENTRY_DUPLICATE;
+		e++;
+	}
+	qsort(entries, count, sizeof(*entries), cmp_entries);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = NAME_TABLE_MAGIC;
+	hdr.version = NAME_TABLE_VERSION;
+	hdr.count = count;
+	hdr.flags = flags;
+	if (run_key(hdr.key, sizeof(hdr.key), &state->config) ||
+	    run_mkdir(state->config.sysroot, NULL))
+		goto out;
+	run_path(path, sizeof(path), state->config.sysroot, file);
+	fp = run_create(path, tmp, sizeof(tmp));
+	if (!fp)
+		goto out;
+	hdr.published = name_table_now();
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    fwrite(entries, sizeof(*entries), count, fp) != count) {
+		fclose(fp);
+		unlink(tmp);
+		goto out;
+	}
+	/*
+	 * Mark the old table before replacing it: if that fails, it stays
+	 * current, and a reader that maps it again meanwhile finds the same
+	 * names in it.
+	 */
+	old_fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (set_superseded(old_fd, 1)) {
+		fprintf(stderr, "Cannot replace %s: %s\n", path, strerror(errno));
+		close(old_fd);
+		fclose(fp);
+		unlink(tmp);
+		goto out;
+	}
+	rc = run_commit(fp, tmp, path);
+	if (rc)
+		set_superseded(old_fd, 0);
+	if (old_fd >= 0)
+		close(old_fd);
+out:
+	free(entries);
+	return rc;
+}
+
+static int map_table(struct name_table *t)
+{
+	struct stat st;
+	void *p;
+
+	t->fd = open(t->path, O_RDONLY | O_CLOEXEC);
+	if (t->fd < 0)
+		return 1;
+	if (fstat(t->fd, &st) || st.st_size < (off_t)sizeof(*t->hdr))
+		goto err;
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, t->fd, 0);
+	if (p == MAP_FAILED)
+		goto err;
+	t->size = st.st_size;
+	t->hdr = p;
+	t->entries = (const struct name_table_entry *)(t->hdr + 1);
+	if (t->hdr->magic != NAME_TABLE_MAGIC || t->hdr->version != NAME_TABLE_VERSION ||
+	    t->size != sizeof(*t->hdr) + (size_t)t->hdr->count * sizeof(*t->entries)) {
+		munmap(p, t->size);
+		goto err;
+	}
+	return 0;
+err:
+	close(t->fd);
+	t->fd = -1;
+	t->hdr = NULL;
+	return 1;
+}
+
+static void unmap_table(struct name_table *t)
+{
+	if (!t->hdr)
+		return;
+	munmap((void *)t->hdr, t->size);
+	close(t->fd);
+	t->fd = -1;
+	t->hdr = NULL;
+}
+
+struct name_table *name_table_open(const char *sysroot, const char *file)
+{
+	struct name_table *t;
+
+	t = calloc(1, sizeof(*t));
+	if (!t)
+		return NULL;
+	run_path(t->path, sizeof(t->path), sysroot, file);
+	if (map_table(t)) {
+		free(t);
+		return NULL;
+	}
+	return t;
+}
+
+/* Search the newest table; only a replaced one costs any system calls */
+const struct name_table_entry *name_table_find(struct name_table *t, const char *devname)
+{
+	struct name_table_entry key;
+
+	if (t->hdr && t->hdr->superseded)
+		unmap_table(t);
+	if (!t->hdr && map_table(t))
+		return NULL;
+	memset(&key, 0, sizeof(key));
+	snprintf(key.kernel_name, sizeof(key.kernel_name), "%s", devname);
+	return bsearch(&key, t->entries, t->hdr->count, sizeof(*t->entries), cmp_entries);
+}
+
+void name_table_close(struct name_table *t)
+{
+	if (!t)
+		return;
+	unmap_table(t);
+	free(t);
+}
+
+/* Take the table away, and send its readers looking for a new one */
+int name_table_unpublish(const char *sysroot, const char *file)
+{
+	char path[PATH_MAX];
+	int fd, rc = 0;
+
+	run_path(path, sizeof(path), sysroot, file);
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (set_superseded(fd, 1)) {
+		fprintf(stderr, "Cannot mark %s replaced: %s\n", path, strerror(errno));
+		rc = 1;
+	}
+	if (unlink(path)) {
+		set_superseded(fd, 0);
+		rc = 1;
+	}
+	if (fd >= 0)
+		close(fd);
+	return rc;
+}
+
+/* Whether a --monitor holds RUN_DIR/monitor */
+int monitor_running(const char *sysroot)
+{
+	char path[PATH_MAX];
+	int fd, rc;
+
+	run_path(path, sizeof(path), sysroot, "monitor");
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	rc = flock(fd, LOCK_SH | LOCK_NB) && errno == EWOULDBLOCK;
+	close(fd);
+	return rc;
+}
+
+/*
+ * For long-running readers: map the names a running --monitor keeps
+ * current, provided it names them with the same options as config.
+ */
+void * open_published_names(const struct libbiosdevname_config *config)
+{
+	struct libbiosdevname_config c;
+	struct name_table *t;
+	char key[256];
+
+	config_defaults(&c, config);
+	if (!monitor_running(c.sysroot))
+		return NULL;
+	t = name_table_open(c.sysroot, "names");
+	if (!t)
+		return NULL;
+	if (run_key(key, sizeof(key), &c) ||
+	    !(t->hdr->flags & NAME_TABLE_MONITOR) || strncmp(t->hdr->key, key, sizeof(t->hdr->key))) {
+		name_table_close(t);
+		t = NULL;
+	}
+	return t;
+}
+
+/*
+ * The name published for devname, or NULL.  It stays valid until the
+ * next call.  Costs no system calls unless the table has been replaced.
+ */
+const char * published_kern_to_bios(void *names, const char *devname)
+{
+	const struct name_table_entry *e;
+
+	e = name_table_find(names, devname);
+	if (!e || !e->bios_name[0] || (e->flags & NAME_ENTRY_DUPLICATE))
+		return NULL;
+	return e->bios_name;
+}
+
+void close_published_names(void *names)
+{
+	name_table_close(names);
+}
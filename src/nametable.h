@@ -0,0 +1,64 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef NAMETABLE_H_INCLUDED
+#define NAMETABLE_H_INCLUDED
+
+#include <stdint.h>
+#include <limits.h>
+#include <net/if.h>
+#include "state.h"
+
+/*
+ * A published set of names, mapped read-only by whoever wants to look
+ * one up.  Entries are sorted by kernel_name.  A table is never changed
+ * once published, except for superseded: the writer sets it in the old
+ * one just before renaming a new one into place, so a reader that still
+ * has the old one mapped knows to map it again.
+ */
+#define NAME_TABLE_MAGIC	0x746e6462	/* "bdnt" */
+#define NAME_TABLE_VERSION	1
+
+#define NAME_TABLE_MONITOR	1	/* kept current by --monitor */
+
+#define NAME_ENTRY_DUPLICATE	1	/* bios_name is shared, so not used */
+
+struct name_table_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t flags;			/* NAME_TABLE_* */
+	uint64_t published;		/* CLOCK_MONOTONIC ns */
+	volatile uint32_t superseded;
+	uint32_t reserved;
+	char key[256];			/* run_key() */
+};
+
+struct name_table_entry {
+	char kernel_name[IFNAMSIZ];
+	char bios_name[IFNAMSIZ];	/* "" when it has none */
+	char bus_info[32];
+	int32_t ifindex;
+	uint32_t flags;			/* NAME_ENTRY_* */
+};
+
+struct name_table {
+	char path[PATH_MAX];
+	int fd;
+	size_t size;
+	const struct name_table_header *hdr;
+	const struct name_table_entry *entries;
+};
+
+extern unsigned long long name_table_now(void);
+extern int name_table_publish(const struct libbiosdevname_state *state, const char *file,
+			      unsigned int flags);
+extern struct name_table *name_table_open(const char *sysroot, const char *file);
+extern const struct name_table_entry *name_table_find(struct name_table *t, const char *devname);
+extern void name_table_close(struct name_table *t);
+extern int name_table_unpublish(const char *sysroot, const char *file);
+extern int monitor_running(const char *sysroot);
+
+#endif /* NAMETABLE_H_INCLUDED */
@@ -11,6 +11,7 @@
 #include "naming_policy.h"
 #include "libbiosdevname.h"
 #include "state.h"
+#include "profile.h"
 #include "dmidecode/dmidecode.h"
 
 static void use_all_ethN(const struct libbiosdevname_state *state)
@@ -24,13 +25,14 @@ static void use_all_ethN(const struct libbiosdevname_state *state)
 		if (dev->netdev) {
 			snprintf(buffer, sizeof(buffer), "eth%u", i++);
 			dev->bios_name = strdup(buffer);
+			profile_items(PROFILE_NAMING, 1);
 		}
 	}
 }
 
-static void use_physical(const struct libbiosdevname_state *state, const char *prefix)
+/* Give one device its physical name, leaving bios_name NULL when it has none */
+void name_physical(struct bios_device *dev, const char *prefix)
 {
-	struct bios_device *dev;
 	char buffer[IFNAMSIZ];
 	char location[IFNAMSIZ];
 	char port[IFNAMSIZ];
@@ -39,64 +41,91 @@ static void use_physical(const struct libbiosdevname_state *state, const char *p
 	int known=0;
 	struct pci_device *vf;
 
-	list_for_each_entry(dev, &state->bios_devices, node) {
-		known = 0;
-		memset(buffer, 0, sizeof(buffer));
-		memset(location, 0, sizeof(location));
-		memset(port, 0, sizeof(port));
-		memset(interface, 0, sizeof(interface));
+	memset(buffer, 0, sizeof(buffer));
+	memset(location, 0, sizeof(location));
+	memset(port, 0, sizeof(port));
+	memset(interface, 0, sizeof(interface));
+	dev->info.port = -1;
+	dev->info.pfi = -1;
 
-		if (is_pci(dev)) {
-			vf = dev->pcidev;
-			if (dev->pcidev->physical_slot == 0) { /* embedded devices only */
-				portnum = INT_MAX;
-				/* Use master VPD device if available */
-				if (vf->vpd_pf)
-					vf = vf->vpd_pf;
-				if (vf->pf)
-				  	vf = vf->pf;
-				if (dev->port)
-					portnum = dev->port->port;
-				else if (vf->uses_sysfs & HAS_SYSFS_INDEX)
-					portnum = vf->sysfs_index;
-				else if (vf->uses_smbios & HAS_SMBIOS_INSTANCE && is_pci_smbios_type_ethernet(vf))
-					portnum = vf->smbios_instance;
-				else if (vf->embedded_index_valid)
-					portnum = vf->embedded_index;
-				if (portnum != INT_MAX) {	
-					snprintf(location, sizeof(location), "%s%u", prefix, portnum);
-					known=1;
-				}
+	if (is_pci(dev)) {
+		vf = dev->pcidev;
+		if (dev->pcidev->physical_slot == 0) { /* embedded devices only */
+			portnum = INT_MAX;
+			/* Use master VPD device if available */
+			if (vf->vpd_pf)
+				vf = vf->vpd_pf;
+			if (vf->pf)
+			  	vf = vf->pf;
+			if (dev->port) {
+				portnum = dev->port->port;
+				dev->location_source = NAME_SOURCE_DRIVER_PORT;
+			} else if (vf->uses_sysfs & HAS_SYSFS_INDEX) {
+				portnum = vf->sysfs_index;
+				dev->location_source = NAME_SOURCE_SYSFS_INDEX;
+			} else if (vf->uses_smbios & HAS_SMBIOS_INSTANCE && is_pci_smbios_type_ethernet(vf)) {
+				portnum = vf->smbios_instance;
+				dev->location_source = NAME_SOURCE_SMBIOS_INSTANCE;
+			} else if (vf->embedded_index_valid) {
+				portnum = vf->embedded_index;
+				dev->location_source = NAME_SOURCE_EMBEDDED_INDEX;
 			}
-			else if (dev->pcidev->physical_slot < PHYSICAL_SLOT_UNKNOWN) {
-				snprintf(location, sizeof(location), "p%u", dev->pcidev->physical_slot);
-				if (dev->port)
-					portnum = dev->port->port;
-				else if (dev->pcidev->vpd_port < INT_MAX)
-					portnum = dev->pcidev->vpd_port;
-				else if (!dev->pcidev->is_sriov_virtual_function)
-				  	portnum = dev->pcidev->index_in_slot;
-				else
-					portnum = dev->pcidev->pf->index_in_slot;
-				snprintf(port, sizeof(port), "p%u", portnum);
+			if (portnum != INT_MAX) {	
+				snprintf(location, sizeof(location), "%s%u", prefix, portnum);
+				dev->info.port = portnum;
 				known=1;
 			}
+		}
+		else if (dev->pcidev->physical_slot < PHYSICAL_SLOT_UNKNOWN) {
+			snprintf(location, sizeof(location), "p%u", dev->pcidev->physical_slot);
+			dev->location_source = NAME_SOURCE_SLOT;
+			if (dev->port) {
+				portnum = dev->port->port;
+				dev->port_source = NAME_SOURCE_DRIVER_PORT;
+			} else if (dev->pcidev->vpd_port < INT_MAX) {
+				portnum = dev->pcidev->vpd_port;
+				dev->port_source = NAME_SOURCE_VPD_PORT;
+			} else if (!dev->pcidev->is_sriov_virtual_function) {
+			  	portnum = dev->pcidev->index_in_slot;
+				dev->port_source = NAME_SOURCE_INDEX_IN_SLOT;
+			} else {
+				portnum = dev->pcidev->pf->index_in_slot;
+				dev->port_source = NAME_SOURCE_PF_INDEX_IN_SLOT;
+			}
+			snprintf(port, sizeof(port), "p%u", portnum);
+			dev->info.port = portnum;
+			known=1;
+		}
 
-			if (dev->port && dev->port->pfi != -1)
-				snprintf(interface, sizeof(interface), "_%u", dev->port->pfi);
-			else if (dev->pcidev->is_sriov_virtual_function)
-				snprintf(interface, sizeof(interface), "_%u", dev->pcidev->vf_index);
-			else if (dev->pcidev->vpd_pfi < INT_MAX)
-				snprintf(interface, sizeof(interface), "_%u", dev->pcidev->vpd_pfi);
+		if (dev->port && dev->port->pfi != -1) {
+			dev->info.pfi = dev->port->pfi;
+			dev->interface_source = NAME_SOURCE_DRIVER_PFI;
+		} else if (dev->pcidev->is_sriov_virtual_function) {
+			dev->info.pfi = dev->pcidev->vf_index;
+			dev->interface_source = NAME_SOURCE_VF_INDEX;
+		} else if (dev->pcidev->vpd_pfi < INT_MAX) {
+			dev->info.pfi = dev->pcidev->vpd_pfi;
+			dev->interface_source = NAME_SOURCE_VPD_PFI;
+		}
+		if (dev->info.pfi != -1)
+			snprintf(interface, sizeof(interface), "_%u", dev->info.pfi);
 
-			if (known) {
-				snprintf(buffer, sizeof(buffer), "%s%s%s", location, port, interface);
-				dev->bios_name = strdup(buffer);
-			}
+		if (known) {
+			snprintf(buffer, sizeof(buffer), "%s%s%s", location, port, interface);
+			dev->bios_name = strdup(buffer);
+			profile_items(PROFILE_NAMING, 1);
 		}
 	}
 }
 
+static void use_physical(const struct libbiosdevname_state *state, const char *prefix)
+{
+	struct bios_device *dev;
+
+	list_for_each_entry(dev, &state->bios_devices, node)
+		name_physical(dev, prefix);
+}
+
 
 int assign_bios_network_names(const struct libbiosdevname_state *state, int policy, const char *prefix)
 {
@@ -8,7 +8,12 @@
 
 #include "state.h"
 
+/* NAME_SOURCE_* are in libbiosdevname.h, for the device records */
+
+struct bios_device;
+
 extern int assign_bios_network_names(const struct libbiosdevname_state *state,
 				     int namingpolicy, const char *prefix);
+extern void name_physical(struct bios_device *dev, const char *prefix);
 
 #endif /* NAMING_POLICY_H_INCLUDED */
@@ -20,76 +20,52 @@
 #include "sysfs.h"
 #include "dmidecode/dmidecode.h"
 #include "pirq.h"
-
-extern int is_valid_smbios;
+#include "vpd.h"
+#include "profile.h"
+#include "io.h"
+#include "trace.h"
 
 #ifndef PCI_CB_CAPABILITY_LIST
 #define PCI_CB_CAPABILITY_LIST	0x14
 #endif
 
-/* Borrowed from kernel vpd code */
-#define PCI_VPD_LRDT			0x80
-#define PCI_VPD_SRDT_END		0x78
-#define PCI_VPDI_TAG			0x82
-#define PCI_VPDR_TAG			0x90
-
-#define PCI_VPD_SRDT_LEN_MASK		0x7
-#define PCI_VPD_LRDT_TAG_SIZE		3
-#define PCI_VPD_SRDT_TAG_SIZE		1
-#define PCI_VPD_INFO_FLD_HDR_SIZE	3
-
-struct vpd_tag
+/* Config space reads, counted when profiling and timed when tracing */
+static u8 cfg_read_byte(struct pci_dev *p, int pos)
 {
-	char	cc[2];
-	u8	len;
-	char	data[1];
-};
+	unsigned long long t = trace_now();
+	u8 v = pci_read_byte(p, pos);
 
-static inline u16 pci_vpd_lrdt_size(const u8 *lrdt)
-{
-	return (u16)lrdt[0] + ((u16)lrdt[1] << 8L);
+	profile_io(IO_CONFIG, 1);
+	trace_io("config", t, NULL, 1);
+	return v;
 }
 
-static inline u8 pci_vpd_srdt_size(const u8* srdt)
+static u16 cfg_read_word(struct pci_dev *p, int pos)
 {
-	return (*srdt) & PCI_VPD_SRDT_LEN_MASK;
+	unsigned long long t = trace_now();
+	u16 v = pci_read_word(p, pos);
+
+	profile_io(IO_CONFIG, 1);
+	trace_io("config", t, NULL, 2);
+	return v;
 }
 
-static int pci_vpd_readtag(int fd, int *len)
+static u32 cfg_read_long(struct pci_dev *p, int pos)
 {
-	u8 tag, tlen[2];
+	unsigned long long t = trace_now();
+	u32 v = pci_read_long(p, pos);
 
-	if (read(fd, &tag, 1) != 1)
-		return -1;
-	if (tag == 0x00 || tag == 0xFF || tag == 0x7F)
-		return -1;
-	if (tag & PCI_VPD_LRDT) {
-		if (read(fd, tlen, 2) != 2)
-			return -1;
-		*len = pci_vpd_lrdt_size(tlen);
-		/* Check length of VPD-R */
-		if (*len  >= 1024)
-			return -1;
-		return tag;
-	}
-	*len = pci_vpd_srdt_size(&tag);
-	return (tag & ~0x7);
+	profile_io(IO_CONFIG, 1);
+	trace_io("config", t, NULL, 4);
+	return v;
 }
 
-static void *pci_vpd_findtag(void *buf, int len, const char *sig)
+/* Time and I/O from here to profile_device_end() are done on behalf of p */
+static void pci_device_begin(struct io_stats **cost, enum profile_source source,
+			     const struct pci_dev *p)
 {
-        int off, siglen;
-        struct vpd_tag *t;
-
-        off = 0;
-        siglen = strlen(sig);
-        while (off < len) {
-                t = (struct vpd_tag *)((u8 *)buf + off);
-                if (!memcmp(t->data, sig, siglen))
-                        return t;
-                off += (t->len + 3);
-        }
-        return NULL;
+	profile_device_begin(cost, source, "%04x:%02x:%02x.%x",
+			     pci_domain_nr(p), p->bus, p->dev, p->func);
 }
 
 /* Add port identifier(s) to PCI device */
@@ -111,46 +87,37 @@ static void add_port(struct pci_device *pdev, int port, int pfi)
 	list_add_tail(&p->node, &pdev->ports);
 }
 
+struct dcm_walk {
+	struct libbiosdevname_state *state;
+	struct pci_device *pdev;
+};
+
+static void add_dcm_port(void *arg, int port, int devfn, int pfi)
+{
+	struct dcm_walk *walk = arg;
+	struct pci_device *vf;
+
+	vf = find_pci_dev_by_pci_addr(walk->state, walk->pdev->pci_dev->domain,
+				      walk->pdev->pci_dev->bus,
+				      devfn >> 3, devfn & 7);
+	if (vf != NULL && !vf->is_sriov_virtual_function) {
+		add_port(vf, port, pfi);
+		if (vf->vpd_port == INT_MAX) {
+			vf->vpd_port = port;
+			vf->vpd_pfi = pfi;
+		}
+	}
+}
+
 static void parse_dcm(struct libbiosdevname_state *state, struct pci_device *pdev,
 		      void *vpd, int len)
 {
-	int i, port, devfn, pfi, step;
-	struct pci_device *vf;
-	struct vpd_tag *dcm;
-	const char *fmt;
+	struct dcm_walk walk = { state, pdev };
 
         if (pdev->is_sriov_virtual_function) {
                 return ;
         }
-	
-	fmt = "%1x%1x%2x";
-	step = 10;
-	dcm = pci_vpd_findtag(vpd, len, "DCM");
-	if (dcm == NULL) {
-		dcm = pci_vpd_findtag(vpd, len, "DC2");
-		if (dcm == NULL)
-			return;
-		fmt = "%1x%2x%2x";
-		step = 11;
-	}
-	for (i = 3; i < dcm->len; i += step) {
-		if (i+step > dcm->len) {
-			/* DCM is truncated */
-			return;
-		}
-		if (sscanf(dcm->data+i, fmt, &port, &devfn, &pfi) != 3)
-			break;
-		vf = find_pci_dev_by_pci_addr(state, pdev->pci_dev->domain,
-					      pdev->pci_dev->bus,
-					      devfn >> 3, devfn & 7);
-		if (vf != NULL && !vf->is_sriov_virtual_function) {
-			add_port(vf, port, pfi);
-			if (vf->vpd_port == INT_MAX) {
-				vf->vpd_port = port;
-				vf->vpd_pfi = pfi;
-			}
-		}
-	}
+	pci_vpd_parse_dcm(vpd, len, add_dcm_port, &walk);
 }
 
 /* Read and parse PCI VPD section if it exists */
@@ -159,26 +126,22 @@ static int read_pci_vpd(struct libbiosdevname_state *state, struct pci_device *p
 	char path[PATH_MAX];
 	char pci_name[16];
 	int fd, len;
-	unsigned char *vpd;
+	u8 vpd[PCI_VPDR_MAX_LEN];
 
 	if (!is_pci_network(pdev) || pdev->is_sriov_virtual_function)
 		return 1;
 	unparse_pci_name(pci_name, sizeof(pci_name), pdev->pci_dev);
-	snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/physfn/vpd", pci_name);
-	fd = open(path, O_RDONLY|O_SYNC);
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/physfn/vpd", state->config.sysroot, pci_name);
+	fd = io_open(path, O_RDONLY|O_SYNC);
 	if (fd < 0) {
-		snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/vpd", pci_name);
-		fd = open(path, O_RDONLY|O_SYNC);
+		snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/vpd", state->config.sysroot, pci_name);
+		fd = io_open(path, O_RDONLY|O_SYNC);
 		if (fd < 0)
 			return 1;
 	}
-	if (pci_vpd_readtag(fd, &len) != PCI_VPDI_TAG)
-		goto done;
-	lseek(fd, len, SEEK_CUR);
-	if (pci_vpd_readtag(fd, &len) != PCI_VPDR_TAG)
-		goto done;
-	vpd = alloca(len);
-	if (read(fd, vpd, len) != len)
+	profile_items(PROFILE_VPD, 1);
+	len = pci_vpd_read_vpdr(fd, vpd, sizeof(vpd));
+	if (len < 0)
 		goto done;
 	/* Check for DELL VPD tag */
 	if (!pci_vpd_findtag(vpd, len, "DSV1028VPDR.VER"))
@@ -189,27 +152,49 @@ static int read_pci_vpd(struct libbiosdevname_state *state, struct pci_device *p
 	return 0;
 }
 
-static void set_pci_vpd_instance(struct libbiosdevname_state *state)
+static int on_bus(const struct pci_device *dev, int domain, int bus)
+{
+	return domain < 0 ||
+		(pci_domain_nr(dev->pci_dev) == domain && dev->pci_dev->bus == bus);
+}
+
+/* VPD-R is only read on Dell systems; sys_vendor is read once per state */
+static int is_dell_system(struct libbiosdevname_state *state)
 {
-	struct pci_device *dev, *dev2;
-	int fd;
 	char sys_vendor[10] = {0};
+	char path[PATH_MAX];
+	int fd;
 
-	/* Read VPD-R on Dell systems only */
-	if ((fd = open("/sys/devices/virtual/dmi/id/sys_vendor", O_RDONLY)) >= 0) {
-		if (read(fd, sys_vendor, 9) != 9) {
-			close(fd);
-			return;
-		}
-		if (strncmp(sys_vendor, "Dell Inc.", 9)) {
-			close(fd);
-			return;
-		}
-	} else
+	if (state->is_dell >= 0)
+		return state->is_dell;
+	state->is_dell = 0;
+	snprintf(path, sizeof(path), "%s/sys/devices/virtual/dmi/id/sys_vendor", state->config.sysroot);
+	if ((fd = io_open(path, O_RDONLY)) < 0)
+		return 0;
+	if (io_read(fd, sys_vendor, 9) == 9 && !strncmp(sys_vendor, "Dell Inc.", 9))
+		state->is_dell = 1;
+	close(fd);
+	return state->is_dell;
+}
+
+/*
+ * VPD master functions are always on the same bus, so a bus can be redone
+ * alone.  A function only becomes embedded like its master when SMBIOS
+ * made the master embedded, so whatever order slots are worked out in,
+ * the result is the same.
+ */
+static void set_pci_vpd_instance(struct libbiosdevname_state *state, int domain, int bus)
+{
+	struct pci_device *dev, *dev2;
+
+	if (!is_dell_system(state))
 		return;
 
 	/* Read VPD information for each device */
 	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (!on_bus(dev, domain, bus))
+			continue;
+		dev->vpd_read = 1;
 		/* RedHat bugzilla 801885, 789635, 781572 */
 		if (dev->pci_dev->vendor_id == 0x1969 ||
 		    dev->pci_dev->vendor_id == 0x168c)
@@ -221,12 +206,15 @@ static void set_pci_vpd_instance(struct libbiosdevname_state *state)
                 if (dev->is_sriov_virtual_function) {
                         continue;
                 }
+		pci_device_begin(&dev->cost, SOURCE_VPD, dev->pci_dev);
 		read_pci_vpd(state, dev);
+		profile_device_end();
 	}
 
 	/* Now match VPD master device */
 	list_for_each_entry(dev, &state->pci_devices, node) {
-		if (dev->vpd_port == INT_MAX || dev->is_sriov_virtual_function)
+		if (dev->vpd_port == INT_MAX || dev->is_sriov_virtual_function ||
+		    !on_bus(dev, domain, bus))
 			continue;
 		list_for_each_entry(dev2, &state->pci_devices, node) {
 			if (dev2->pci_dev->domain == dev->pci_dev->domain &&
@@ -234,8 +222,10 @@ static void set_pci_vpd_instance(struct libbiosdevname_state *state)
 			    dev2->vpd_port == dev->vpd_port) {
 				dev2->vpd_count++;
 				dev->vpd_pf = dev2;
-				if (dev2->physical_slot == 0)
+				if (dev2->smbios_slot == 0 && dev->physical_slot != 0) {
 					dev->physical_slot = 0;
+					dev->slot_source = SLOT_SOURCE_VPD;
+				}
 				break;
 			}
 		}
@@ -243,13 +233,26 @@ static void set_pci_vpd_instance(struct libbiosdevname_state *state)
 
 	/* Delete all VPD devices with single function */
 	list_for_each_entry(dev, &state->pci_devices, node) {
-		if (dev->vpd_count == 1) {
+		if (dev->vpd_count == 1 && on_bus(dev, domain, bus)) {
 			dev->vpd_port = INT_MAX;
 			dev->vpd_pfi = INT_MAX;
 			dev->vpd_pf = NULL;
 		}
 	}
-	close(fd);
+}
+
+/* The buses of the network functions in slot, that haven't been read yet */
+static void set_slot_vpd(struct libbiosdevname_state *state, int slot)
+{
+	struct pci_device *dev;
+
+	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (!is_pci_network(dev) || dev->is_sriov_virtual_function || dev->vpd_read)
+			continue;
+		if (slot == PHYSICAL_SLOT_UNKNOWN ? dev->smbios_slot == 0 :
+		    dev->physical_slot == slot)
+			set_pci_vpd_instance(state, pci_domain_nr(dev->pci_dev), dev->pci_dev->bus);
+	}
 }
 
 static int pci_find_capability(struct pci_dev *p, int cap)
@@ -258,10 +261,10 @@ static int pci_find_capability(struct pci_dev *p, int cap)
 	u8 hdr, id;
 	int pos, ttl = 48;
 
-	status = pci_read_word(p, PCI_STATUS);
+	status = cfg_read_word(p, PCI_STATUS);
 	if (!(status & PCI_STATUS_CAP_LIST))
 		return 0;
-	hdr = pci_read_byte(p, PCI_HEADER_TYPE);
+	hdr = cfg_read_byte(p, PCI_HEADER_TYPE);
 	switch(hdr & 0x7F) {
 	case PCI_HEADER_TYPE_NORMAL:
 	case PCI_HEADER_TYPE_BRIDGE:
@@ -275,11 +278,11 @@ static int pci_find_capability(struct pci_dev *p, int cap)
 	}
 
 	while (ttl--) {
-		pos = pci_read_byte(p, pos);
+		pos = cfg_read_byte(p, pos);
 		if (pos < 0x40)
 			break;
 		pos &= ~3;
-		id = pci_read_byte(p, pos+PCI_CAP_LIST_ID);
+		id = cfg_read_byte(p, pos+PCI_CAP_LIST_ID);
 		if (id == 0xFF)
 			break;
 		if (id == cap)
@@ -300,8 +303,8 @@ static int pcie_get_slot(struct libbiosdevname_state *state, struct pci_device *
 	while (p) {
 		/* Return PCIE physical slot number */
 		if ((pos = pci_find_capability(p->pci_dev, PCI_CAP_ID_EXP)) != 0) {
-			flag = pci_read_word(p->pci_dev, pos + PCI_EXP_FLAGS);
-			slot = (pci_read_long(p->pci_dev, pos + PCI_EXP_SLTCAP) >> 19);
+			flag = cfg_read_word(p->pci_dev, pos + PCI_EXP_FLAGS);
+			slot = (cfg_read_long(p->pci_dev, pos + PCI_EXP_SLTCAP) >> 19);
 			if ((flag & PCI_EXP_FLAGS_SLOT) && slot)
 				return slot;
 		}
@@ -310,14 +313,15 @@ static int pcie_get_slot(struct libbiosdevname_state *state, struct pci_device *
 	return PHYSICAL_SLOT_UNKNOWN;
 }
 
-static int read_pci_sysfs_path(char *buf, size_t bufsize, const struct pci_dev *pdev)
+static int read_pci_sysfs_path(const char *sysroot, char *buf, size_t bufsize,
+			       const struct pci_dev *pdev)
 {
 	char path[PATH_MAX];
 	char pci_name[16];
 	ssize_t size;
 	unparse_pci_name(pci_name, sizeof(pci_name), pdev);
-	snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s", pci_name);
-	size = readlink(path, buf, bufsize);
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s", sysroot, pci_name);
+	size = io_readlink(path, buf, bufsize);
 	if (size == -1)
 		return 1;
 	return 0;
@@ -368,9 +372,12 @@ find_parent(struct libbiosdevname_state *state, struct pci_device *dev)
 	char path[PATH_MAX];
 	char *c;
 	struct pci_dev *pdev;
+	enum profile_source source;
 	memset(path, 0, sizeof(path));
 
-	rc = read_pci_sysfs_path(path, sizeof(path), dev->pci_dev);
+	source = profile_source(SOURCE_PARENT);
+	rc = read_pci_sysfs_path(state->config.sysroot, path, sizeof(path), dev->pci_dev);
+	profile_source(source);
 	if (rc != 0)
 		return NULL;
 	/* we get back a string like
@@ -402,29 +409,84 @@ static inline int pci_dev_to_slot(struct libbiosdevname_state *state, struct pci
 	return dev->physical_slot;
 }
 
-static inline int pirq_dev_to_slot(struct libbiosdevname_state *state, struct pci_device *dev)
+static int pirq_dev_to_slot(struct libbiosdevname_state *state, struct pci_device *dev)
 {
-	return pirq_pci_dev_to_slot(state->pirq_table, pci_domain_nr(dev->pci_dev), dev->pci_dev->bus, dev->pci_dev->dev);
+	struct routing_table *table;
+	enum profile_source source;
+	int slot;
+
+	source = profile_source(SOURCE_PIRQ);
+	/* Only read $PIR once some device has run out of cheaper sources */
+	if (!state->pirq_loaded) {
+		state->pirq_loaded = 1;
+		profile_begin(PROFILE_PIRQ);
+		table = pirq_alloc_read_table(state);
+		if (table) {
+			state->pirq_map = pirq_alloc_slot_map(table);
+			profile_items(PROFILE_PIRQ, (table->size - 32) / 16);
+			pirq_free_table(table);
+		}
+		profile_end(PROFILE_PIRQ);
+	}
+	slot = pirq_pci_dev_to_slot(state->pirq_map, pci_domain_nr(dev->pci_dev), dev->pci_dev->bus, dev->pci_dev->dev);
+	profile_source(source);
+	return slot;
+}
+
+/* The SMBIOS table is decoded at most once, the first time it's needed */
+static void decode_smbios(struct libbiosdevname_state *state)
+{
+	if (state->smbios_decoded)
+		return;
+	state->smbios_decoded = 1;
+	profile_begin(PROFILE_SMBIOS);
+	dmidecode_main(state);	/* this will fail on Xen guests, that's OK */
+	profile_end(PROFILE_SMBIOS);
 }
 
+/*
+ * Each source is only tried when the ones before it came up empty, and
+ * a parent is evaluated at most once however many functions sit below
+ * it, so only the ancestors of network functions are ever looked at.
+ */
 static void dev_to_slot(struct libbiosdevname_state *state, struct pci_device *dev)
 {
-	struct pci_device *d = dev;
-	int slot;
-	do {
-		slot = pci_dev_to_slot(state, d);
-		if (slot == PHYSICAL_SLOT_UNKNOWN && is_valid_smbios)
-			slot = pcie_get_slot(state, d);
-		if (slot == PHYSICAL_SLOT_UNKNOWN)
-			slot = pirq_dev_to_slot(state, d);
-		if (slot == PHYSICAL_SLOT_UNKNOWN)
-			d = find_parent(state, d);
-	} while (d && slot == PHYSICAL_SLOT_UNKNOWN);
+	struct pci_device *d;
+	int slot, source;
+
+	if (dev->slot_evaluated)
+		return;
+	decode_smbios(state);
+	dev->slot_evaluated = 1;
+	slot = pci_dev_to_slot(state, dev);
+	source = dev->slot_source;
+	if (slot == PHYSICAL_SLOT_UNKNOWN && state->is_valid_smbios) {
+		slot = pcie_get_slot(state, dev);
+		source = SLOT_SOURCE_PCIE;
+	}
+	if (slot == PHYSICAL_SLOT_UNKNOWN) {
+		slot = pirq_dev_to_slot(state, dev);
+		source = SLOT_SOURCE_PIRQ;
+	}
+	if (slot == PHYSICAL_SLOT_UNKNOWN && (d = find_parent(state, dev)) != NULL) {
+		dev_to_slot(state, d);
+		slot = d->physical_slot;
+		source = d->slot_source;
+		dev->slot_parent = d->slot_parent ? d->slot_parent : d;
+	}
 
 	dev->physical_slot = slot;
+	dev->slot_source = slot == PHYSICAL_SLOT_UNKNOWN ? SLOT_SOURCE_NONE : source;
+}
+
+/* The slot of any function, not just a network one, worked out on first use */
+int pci_device_slot(struct libbiosdevname_state *state, struct pci_device *dev)
+{
+	dev_to_slot(state, dev);
+	return dev->physical_slot;
 }
 
-static char *read_pci_sysfs_label(const struct pci_dev *pdev)
+static char *read_pci_sysfs_label(const char *sysroot, const struct pci_dev *pdev)
 {
 	char path[PATH_MAX];
 	char pci_name[16];
@@ -432,14 +494,15 @@ static char *read_pci_sysfs_label(const struct pci_dev *pdev)
 	char *label = NULL;
 
 	unparse_pci_name(pci_name, sizeof(pci_name), pdev);
-	snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/label", pci_name);
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/label", sysroot, pci_name);
 	rc = sysfs_read_file(path, &label);
 	if (rc == 0)
 		return label;
 	return NULL;
 }
 
-static int read_pci_sysfs_index(unsigned int *index, const struct pci_dev *pdev)
+static int read_pci_sysfs_index(const char *sysroot, unsigned int *index,
+				const struct pci_dev *pdev)
 {
 	char path[PATH_MAX];
 	char pci_name[16];
@@ -447,7 +510,7 @@ static int read_pci_sysfs_index(unsigned int *index, const struct pci_dev *pdev)
 	char *indexstr = NULL;
 	unsigned int i;
 	unparse_pci_name(pci_name, sizeof(pci_name), pdev);
-	snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/index", pci_name);
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/index", sysroot, pci_name);
 	rc = sysfs_read_file(path, &indexstr);
 	if (rc == 0) {
 		rc = sscanf(indexstr, "%u", &i);
@@ -460,19 +523,19 @@ static int read_pci_sysfs_index(unsigned int *index, const struct pci_dev *pdev)
 	return 1;
 }
 
-static void fill_pci_dev_sysfs(struct pci_device *dev, struct pci_dev *p)
+static void fill_pci_dev_sysfs(const char *sysroot, struct pci_device *dev, struct pci_dev *p)
 {
 	int rc;
 	unsigned int index = 0;
 	char *label = NULL;
 	char buf[PATH_MAX];
 	unparse_pci_name(buf, sizeof(buf), p);
-	rc = read_pci_sysfs_index(&index, p);
+	rc = read_pci_sysfs_index(sysroot, &index, p);
 	if (!rc) {
 		dev->sysfs_index = index;
 		dev->uses_sysfs |= HAS_SYSFS_INDEX;
 	}
-	label = read_pci_sysfs_label(p);
+	label = read_pci_sysfs_label(sysroot, p);
 	if (label) {
 		dev->sysfs_label = label;
 		dev->uses_sysfs |= HAS_SYSFS_LABEL;
@@ -480,67 +543,118 @@ static void fill_pci_dev_sysfs(struct pci_device *dev, struct pci_dev *p)
 }
 
 
-static void add_pci_dev(struct libbiosdevname_state *state,
-			struct pci_dev *p)
+static unsigned int hash_pci_addr(int domain, int bus, int device, int func)
+{
+	return hash_int((domain << 16) | (bus << 8) | (device << 3) | func);
+}
+
+static struct pci_device *add_pci_dev(struct libbiosdevname_state *state,
+				      struct pci_dev *p)
 {
 	struct pci_device *dev;
 	uint8_t hdr;
 	dev = malloc(sizeof(*dev));
 	if (!dev) {
 		fprintf(stderr, "out of memory\n");
-		return;
+		return NULL;
 	}
 	memset(dev, 0, sizeof(*dev));
 	INIT_LIST_HEAD(&dev->node);
-	INIT_LIST_HEAD(&dev->vfnode);
-	INIT_LIST_HEAD(&dev->vfs);
+	INIT_LIST_HEAD(&dev->addr_node);
 	INIT_LIST_HEAD(&dev->ports);
 	dev->pci_dev = p;
+	pci_device_begin(&dev->cost, SOURCE_PCI, p);
 	dev->physical_slot = PHYSICAL_SLOT_UNKNOWN;
-	dev->class	   = pci_read_word(p, PCI_CLASS_DEVICE);
+	dev->smbios_slot = PHYSICAL_SLOT_UNKNOWN;
+	dev->class	   = cfg_read_word(p, PCI_CLASS_DEVICE);
 	dev->vf_index = INT_MAX;
 	dev->vpd_port = INT_MAX;
 	dev->vpd_pfi  = INT_MAX;
 	dev->vpd_pf = NULL;
-	fill_pci_dev_sysfs(dev, p);
+	profile_source(SOURCE_SYSFS);
+	fill_pci_dev_sysfs(state->config.sysroot, dev, p);
+	profile_source(SOURCE_PCI);
 	list_add(&dev->node, &state->pci_devices);
+	if (state->pci_by_addr.size)
+		list_add_tail(&dev->addr_node,
+			      hash_bucket(&state->pci_by_addr,
+					  hash_pci_addr(pci_domain_nr(p), p->bus, p->dev, p->func)));
 
 	/* Get subordinate bus if this is a bridge */
-	hdr = pci_read_byte(p, PCI_HEADER_TYPE);
+	hdr = cfg_read_byte(p, PCI_HEADER_TYPE);
 	switch (hdr & 0x7F) {
 	case PCI_HEADER_TYPE_BRIDGE:
 	case PCI_HEADER_TYPE_CARDBUS:
-		dev->sbus = pci_read_byte(p, PCI_SECONDARY_BUS);
+		dev->sbus = cfg_read_byte(p, PCI_SECONDARY_BUS);
 		break;
 	default:
 		dev->sbus = -1;
 		break;
 	}
+	profile_device_end();
+	return dev;
+}
+
+static void free_pci_device(struct pci_device *dev)
+{
+	struct pci_port *port, *n;
+
+	list_for_each_entry_safe(port, n, &dev->ports, node) {
+		list_del(&port->node);
+		free(port);
+	}
+	if (dev->smbios_label)
+		free(dev->smbios_label);
+	if (dev->sysfs_label)
+		free(dev->sysfs_label);
+	free(dev->cost);
+	free(dev);
+}
+
+static void free_sriov(struct pci_sriov *sriov)
+{
+	unsigned int i;
+
+	for (i=0; i<sriov->num_vfs; i++) {
+		if (sriov->vf[i].dev)
+			free_pci_device(sriov->vf[i].dev);
+		if (sriov->vf[i].smbios)
+			free_pci_device(sriov->vf[i].smbios);
+	}
+	free(sriov->vf);
+	free(sriov);
 }
 
 void free_pci_devices(struct libbiosdevname_state *state)
 {
 	struct pci_device *pos, *next;
 	list_for_each_entry_safe(pos, next, &state->pci_devices, node) {
-		if (pos->smbios_label)
-			free(pos->smbios_label);
-		if (pos->sysfs_label)
-			free(pos->sysfs_label);
+		if (pos->sriov)
+			free_sriov(pos->sriov);
 		list_del(&pos->node);
-		free(pos);
+		free_pci_device(pos);
 	}
+	hash_table_free(&state->pci_by_addr);
+	hash_table_free(&state->vfs_by_addr);
 }
 
 static void set_pci_slots(struct libbiosdevname_state *state)
 {
 	struct pci_device *dev;
 
+	/* only network functions are named; their parents follow on demand */
 	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (!is_pci_network(dev))
+			continue;
+		pci_device_begin(&dev->cost, SOURCE_PCIE_SLOT, dev->pci_dev);
 		dev_to_slot(state, dev);
+		profile_device_end();
+		profile_items(PROFILE_SLOTS, 1);
 	}
 }
 
-static int set_pci_slot_index(struct libbiosdevname_state *state)
+/* Slots whose order changed are added to changed, when it's given */
+static int set_pci_slot_index(struct libbiosdevname_state *state, struct slot_set *changed)
 {
 	struct pci_device *pcidev;
 	int prevslot=-1;
@@ -560,12 +674,14 @@ static int set_pci_slot_index(struct libbiosdevname_state *state)
 		}
 		else
 			index++;
+		if (changed && pcidev->index_in_slot != index)
+			slot_set_add(changed, pcidev->physical_slot);
 		pcidev->index_in_slot = index;
 	}
 	return 0;
 }
 
-static int set_embedded_index(struct libbiosdevname_state *state)
+static int set_embedded_index(struct libbiosdevname_state *state, struct slot_set *changed)
 {
 	struct pci_device *pcidev;
 	int index=1;
@@ -579,6 +695,8 @@ static int set_embedded_index(struct libbiosdevname_state *state)
 			continue;
 		if (pcidev->vpd_port != INT_MAX)
 			continue;
+		if (changed && (!pcidev->embedded_index_valid || pcidev->embedded_index != index))
+			slot_set_add(changed, 0);
 		pcidev->embedded_index = index;
 		pcidev->embedded_index_valid = 1;
 		index++;
@@ -591,59 +709,294 @@ static int virtfn_filter(const struct dirent *dent)
 	return (!strncmp(dent->d_name,"virtfn",6));
 }
 
-/* Assign Virtual Function to Physical Function */
-static void set_sriov(struct libbiosdevname_state *state, struct pci_device *pf, const char *virtpath)
+static int read_sysfs_uint(const char *path, unsigned int *value)
 {
-	struct pci_device *vf;
-	char pci_name[32];
-	char path[PATH_MAX], cpath[PATH_MAX];
-	unsigned vf_index;
+	char *str = NULL;
+	int rc;
 
-	if (sscanf(virtpath, "virtfn%u", &vf_index) != 1)
-		return;
-	unparse_pci_name(pci_name, sizeof(pci_name), pf->pci_dev);
-	snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/%s", pci_name, virtpath);
+	if (sysfs_read_file(path, &str))
+		return 1;
+	rc = sscanf(str, "%u", value);
+	free(str);
+	return rc != 1;
+}
 
-	memset(cpath, 0, sizeof(cpath));
-	if (readlink(path, cpath, sizeof(cpath) - 1) < 0)
+/* Older kernels lack sriov_offset/sriov_stride, so follow the virtfn links */
+static void read_sriov_links(struct pci_sriov *sriov, const char *devpath)
+{
+	char path[PATH_MAX], cpath[PATH_MAX];
+	struct dirent **namelist;
+	struct pci_vf *vf;
+	unsigned int vf_index;
+	int n;
+
+	namelist = NULL;
+	n = io_scandir(devpath, &namelist, virtfn_filter, versionsort);
+	if (n <= 0)
 		return;
-	if ((vf = find_dev_by_pci_name(state, cpath)) != NULL) {
-		vf->is_sriov_virtual_function = 1;
-		vf->vf_index = vf_index;
-		vf->pf = pf;
-		pf->is_sriov_physical_function = 1;
-		if (pf->smbios_enabled) {
-			vf->smbios_instance = pf->smbios_instance;
-			vf->physical_slot = pf->physical_slot;
+	while (n--) {
+		if (sscanf(namelist[n]->d_name, "virtfn%u", &vf_index) == 1 &&
+		    vf_index < sriov->num_vfs) {
+			vf = &sriov->vf[vf_index];
+			snprintf(path, sizeof(path), "%s/%s", devpath, namelist[n]->d_name);
+			memset(cpath, 0, sizeof(cpath));
+			if (io_readlink(path, cpath, sizeof(cpath) - 1) < 0 ||
+			    parse_pci_name(cpath, &vf->domain, &vf->bus, &vf->device, &vf->func))
+				vf->domain = -1;
 		}
-		list_add_tail(&vf->vfnode, &pf->vfs);
+		free(namelist[n]);
 	}
+	free(namelist);
 }
 
-static void scan_sriov(struct libbiosdevname_state *state)
+/*
+ * Describe the VFs of an SR-IOV PF from its sriov_* attributes.  VF
+ * addresses follow from the First VF Offset and VF Stride, so there is
+ * no need to probe each VF.
+ */
+static struct pci_sriov *read_sriov(const char *sysroot, struct pci_dev *p)
 {
-	struct pci_device *pf;
 	char path[PATH_MAX];
+	char devpath[PATH_MAX];
 	char pci_name[32];
-	struct dirent **namelist;
-	int n;
+	struct pci_sriov *sriov;
+	unsigned int num_vfs, i, rid;
+
+	unparse_pci_name(pci_name, sizeof(pci_name), p);
+	if (sysfs_path(devpath, sizeof(devpath), "%s/sys/bus/pci/devices/%s", sysroot, pci_name) ||
+	    sysfs_path(path, sizeof(path), "%s/sriov_numvfs", devpath))
+		return NULL;
+	if (read_sysfs_uint(path, &num_vfs) || num_vfs == 0)
+		return NULL;
+
+	sriov = malloc(sizeof(*sriov));
+	if (!sriov)
+		return NULL;
+	memset(sriov, 0, sizeof(*sriov));
+	sriov->vf = calloc(num_vfs, sizeof(*sriov->vf));
+	if (!sriov->vf) {
+		free(sriov);
+		return NULL;
+	}
+	sriov->num_vfs = num_vfs;
+	for (i=0; i<num_vfs; i++) {
+		INIT_LIST_HEAD(&sriov->vf[i].addr_node);
+		sriov->vf[i].vf_index = i;
+		sriov->vf[i].domain = -1;
+	}
 
+	if (sysfs_path(path, sizeof(path), "%s/sriov_offset", devpath) ||
+	    read_sysfs_uint(path, &sriov->offset)) {
+		read_sriov_links(sriov, devpath);
+		return sriov;
+	}
+	if (sysfs_path(path, sizeof(path), "%s/sriov_stride", devpath) ||
+	    read_sysfs_uint(path, &sriov->stride))
+		sriov->stride = 0;
+	if (!sriov->stride && num_vfs > 1) {
+		read_sriov_links(sriov, devpath);
+		return sriov;
+	}
+	for (i=0; i<num_vfs; i++) {
+		rid = (p->bus << 8) + (p->dev << 3) + p->func + sriov->offset + i * sriov->stride;
+		sriov->vf[i].domain = pci_domain_nr(p);
+		sriov->vf[i].bus = (rid >> 8) & 0xFF;
+		sriov->vf[i].device = (rid >> 3) & 0x1F;
+		sriov->vf[i].func = rid & 0x7;
+	}
+	return sriov;
+}
+
+static struct pci_vf *find_vf_by_pci(const struct libbiosdevname_state *state,
+				     const struct pci_dev *p)
+{
+	struct pci_vf *vf;
+	struct list_head *bucket;
+
+	if (!state->vfs_by_addr.size)
+		return NULL;
+	bucket = hash_bucket(&state->vfs_by_addr,
+			     hash_pci_addr(pci_domain_nr(p), p->bus, p->dev, p->func));
+	list_for_each_entry(vf, bucket, addr_node) {
+		if (vf->domain == pci_domain_nr(p) && vf->bus == p->bus &&
+		    vf->device == p->dev && vf->func == p->func)
+			return vf;
+	}
+	return NULL;
+}
+
+/*
+ * Add the SR-IOV PFs first, and note where their VFs live, so the VFs
+ * can be left out of the device list when the bus scan reaches them.
+ */
+static void scan_sriov(struct libbiosdevname_state *state, struct pci_access *pacc)
+{
+	struct pci_dev *p;
+	struct pci_device *pf;
+	struct pci_sriov *sriov;
+	struct pci_vf *vf;
+	struct io_stats *cost = NULL;
+	unsigned int i, num_vfs = 0;
+
+	for (p=pacc->devices; p; p=p->next) {
+		/* the PF doesn't exist yet, so keep its cost aside */
+		if (cost)
+			memset(cost, 0, PROFILE_SOURCES * sizeof(*cost));
+		pci_device_begin(&cost, SOURCE_SRIOV, p);
+		sriov = read_sriov(state->config.sysroot, p);
+		profile_device_end();
+		if (!sriov)
+			continue;
+		pf = add_pci_dev(state, p);
+		if (!pf) {
+			free_sriov(sriov);
+			continue;
+		}
+		if (cost && pf->cost)
+			io_stats_add(&pf->cost[SOURCE_SRIOV], &cost[SOURCE_SRIOV]);
+		pf->sriov = sriov;
+		for (i=0; i<sriov->num_vfs; i++)
+			sriov->vf[i].pf = pf;
+		num_vfs += sriov->num_vfs;
+	}
+	free(cost);
+	profile_items(PROFILE_SRIOV, num_vfs);
+	if (!num_vfs || hash_table_init(&state->vfs_by_addr, num_vfs))
+		return;
 	list_for_each_entry(pf, &state->pci_devices, node) {
-		unparse_pci_name(pci_name, sizeof(pci_name), pf->pci_dev);
-		snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s", pci_name);
+		if (!pf->sriov)
+			continue;
+		for (i=0; i<pf->sriov->num_vfs; i++) {
+			vf = &pf->sriov->vf[i];
+			if (vf->domain < 0)
+				continue;
+			list_add_tail(&vf->addr_node,
+				      hash_bucket(&state->vfs_by_addr,
+						  hash_pci_addr(vf->domain, vf->bus, vf->device, vf->func)));
+		}
+	}
+}
+
+/* The PF is SR-IOV capable once the bus scan found at least one VF */
+static void set_sriov(struct libbiosdevname_state *state)
+{
+	struct pci_device *pf;
+	unsigned int i;
 
-		namelist = NULL;
-		n = scandir(path, &namelist, virtfn_filter, versionsort);
-		if (n <= 0)
+	list_for_each_entry(pf, &state->pci_devices, node) {
+		if (!pf->sriov)
 			continue;
-		while (n--) {
-			set_sriov(state, pf, namelist[n]->d_name);
-			free(namelist[n]);
+		for (i=0; i<pf->sriov->num_vfs; i++) {
+			if (pf->sriov->vf[i].pci_dev) {
+				pf->is_sriov_physical_function = 1;
+				break;
+			}
 		}
-		free(namelist);
 	}
 }
 
+/*
+ * A VF takes the slot SMBIOS gave its PF, from before any VPD override.
+ * Otherwise it works out its own, the same way any other function does.
+ */
+static void set_vf_slot(struct libbiosdevname_state *state, struct pci_device *dev)
+{
+	struct pci_device *pf = dev->pf;
+
+	dev->slot_parent = NULL;
+	if (pf->smbios_enabled) {
+		dev->physical_slot = pf->smbios_slot;
+		dev->slot_source = SLOT_SOURCE_PF;
+		dev->slot_evaluated = 1;
+		return;
+	}
+	if (dev->smbios_enabled) {
+		dev->physical_slot = dev->smbios_slot;
+		dev->slot_source = SLOT_SOURCE_SMBIOS;
+	} else {
+		dev->physical_slot = PHYSICAL_SLOT_UNKNOWN;
+		dev->slot_source = SLOT_SOURCE_NONE;
+	}
+	dev->slot_evaluated = 0;
+	if (dev->pci_dev)
+		dev_to_slot(state, dev);
+}
+
+/* A VF's own SMBIOS record, with the PF's instance when the PF has one */
+static void set_vf_smbios(struct pci_device *dev, const struct pci_vf *vf)
+{
+	const struct pci_device *rec = vf->smbios;
+
+	free(dev->smbios_label);
+	dev->smbios_label = NULL;
+	dev->uses_smbios = 0;
+	dev->smbios_type = 0;
+	dev->smbios_instance = 0;
+	dev->smbios_enabled = 0;
+	dev->smbios_slot = PHYSICAL_SLOT_UNKNOWN;
+	if (rec && rec->smbios_enabled) {
+		dev->uses_smbios = rec->uses_smbios;
+		dev->smbios_type = rec->smbios_type;
+		dev->smbios_instance = rec->smbios_instance;
+		dev->smbios_enabled = 1;
+		dev->smbios_slot = rec->smbios_slot;
+		if (rec->smbios_label)
+			dev->smbios_label = strdup(rec->smbios_label);
+		if (!dev->smbios_label)
+			dev->uses_smbios &= ~HAS_SMBIOS_LABEL;
+	}
+	if (vf->pf->smbios_enabled)
+		dev->smbios_instance = vf->pf->smbios_instance;
+}
+
+/*
+ * What a VF's pci_device takes from its PF.  Without a pci_dev, a VF
+ * whose PF isn't in SMBIOS is left in an unknown slot.  The caller
+ * frees smbios_label.
+ */
+void init_vf_device(struct libbiosdevname_state *state, struct pci_device *dev,
+		    const struct pci_vf *vf)
+{
+	struct pci_device *pf = vf->pf;
+
+	memset(dev, 0, sizeof(*dev));
+	INIT_LIST_HEAD(&dev->node);
+	INIT_LIST_HEAD(&dev->addr_node);
+	INIT_LIST_HEAD(&dev->ports);
+	dev->pci_dev = vf->pci_dev;
+	dev->class = pf->class;
+	dev->sbus = -1;
+	set_vf_smbios(dev, vf);
+	dev->vf_index = vf->vf_index;
+	dev->vpd_port = INT_MAX;
+	dev->vpd_pfi = INT_MAX;
+	dev->pf = pf;
+	dev->is_sriov_virtual_function = 1;
+	set_vf_slot(state, dev);
+}
+
+/*
+ * Create the full pci_device for a VF once a netdev binds to it.  Class
+ * and SMBIOS information come from the PF.
+ */
+struct pci_device *pci_vf_device(struct libbiosdevname_state *state, struct pci_vf *vf)
+{
+	struct pci_device *dev;
+
+	if (vf->dev)
+		return vf->dev;
+	if (!vf->pci_dev)
+		return NULL;
+	dev = malloc(sizeof(*dev));
+	if (!dev) {
+		fprintf(stderr, "out of memory\n");
+		return NULL;
+	}
+	init_vf_device(state, dev, vf);
+	vf->dev = dev;
+	return dev;
+}
+
 /*
  * This sorts the PCI devices by breadth-first domain/bus/dev/fn.
  */
@@ -688,42 +1041,116 @@ static void sort_device_list(struct libbiosdevname_state *state)
 	list_splice(&sorted_devices, &state->pci_devices);
 }
 
-int get_pci_devices(struct libbiosdevname_state *state)
+static int has_pci_network(const struct libbiosdevname_state *state)
 {
+	struct pci_device *dev;
+
+	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (is_pci_network(dev))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * With target, the PCI name of one function, VPD is only read where it
+ * can change target's name or tell it apart from another: first on the
+ * buses where SMBIOS put an embedded network function, the only ones
+ * where VPD can move a function out of its slot, then, once every slot
+ * is known, on the buses of the network functions in target's slot.
+ */
+static int discover_pci_devices(struct libbiosdevname_state *state, const char *target)
+{
+	struct pci_device *t;
 	struct pci_access *pacc;
 	struct pci_dev *p;
-	struct routing_table *table;
-
-	table = pirq_alloc_read_table();
-	if (table)
-		state->pirq_table = table;
+	unsigned int count = 0;
+	char path[PATH_MAX];
 
 	pacc = pci_alloc();
 	if (!pacc)
 		return 0;
-#if 0
-	pci_set_param(pacc, "dump.name", "lspci.txt");
-	pacc->method = PCI_ACCESS_DUMP;
-#endif
+	/* Replay config space from the lspci -xxxx style dump of a capture */
+	if (*state->config.sysroot) {
+		snprintf(path, sizeof(path), "%s/%s", state->config.sysroot, PCI_DUMP_FILE);
+		state->pci_dump = strdup(path);
+		if (state->pci_dump) {
+			pci_set_param(pacc, "dump.name", state->pci_dump);
+			pacc->method = PCI_ACCESS_DUMP;
+		}
+	}
 	state->pacc = pacc;
+	profile_begin(PROFILE_PCI_SCAN);
 	pci_init(pacc);
 	pci_scan_bus(pacc);
 
+	for (p=pacc->devices; p; p=p->next)
+		count++;
+	profile_items(PROFILE_PCI_SCAN, count);
+	profile_end(PROFILE_PCI_SCAN);
+	hash_table_init(&state->pci_by_addr, count);
+
+	profile_begin(PROFILE_SRIOV);
+	scan_sriov(state, pacc);
+	profile_end(PROFILE_SRIOV);
+	profile_begin(PROFILE_ADD_PCI);
 	for (p=pacc->devices; p; p=p->next) {
-		add_pci_dev(state, p);
+		struct pci_vf *vf = find_vf_by_pci(state, p);
+		if (vf) {
+			vf->pci_dev = p;
+			continue;
+		}
+		if (!find_dev_by_pci(state, p)) {
+			add_pci_dev(state, p);
+			profile_items(PROFILE_ADD_PCI, 1);
+		}
 	}
-	/* ordering here is important */
-	dmidecode_main(state);	/* this will fail on Xen guests, that's OK */
+	profile_end(PROFILE_ADD_PCI);
+	/*
+	 * ordering here is important.  Without a network function nothing
+	 * needs SMBIOS until something asks for a slot.
+	 */
+	if (has_pci_network(state))
+		decode_smbios(state);
+	profile_begin(PROFILE_SORT_PCI);
 	sort_device_list(state);
-	scan_sriov(state);
-	set_pci_vpd_instance(state);
+	profile_end(PROFILE_SORT_PCI);
+	profile_begin(PROFILE_SET_SRIOV);
+	set_sriov(state);
+	profile_end(PROFILE_SET_SRIOV);
+	profile_begin(PROFILE_VPD);
+	if (target)
+		set_slot_vpd(state, PHYSICAL_SLOT_UNKNOWN);
+	else
+		set_pci_vpd_instance(state, -1, -1);
+	profile_end(PROFILE_VPD);
+	profile_begin(PROFILE_SLOTS);
 	set_pci_slots(state);
-	set_embedded_index(state);
-	set_pci_slot_index(state);
+	profile_end(PROFILE_SLOTS);
+	if (target && (t = find_slot_dev_by_pci_name(state, target)) != NULL) {
+		profile_begin(PROFILE_VPD);
+		set_slot_vpd(state, t->physical_slot);
+		profile_end(PROFILE_VPD);
+	}
+	profile_begin(PROFILE_INDEX);
+	set_embedded_index(state, NULL);
+	set_pci_slot_index(state, NULL);
+	profile_end(PROFILE_INDEX);
 
 	return 0;
 }
 
+int get_pci_devices(struct libbiosdevname_state *state)
+{
+	return discover_pci_devices(state, NULL);
+}
+
+/* Enough to name the function pci_name and tell it apart from its slot */
+int get_pci_devices_for(struct libbiosdevname_state *state, const char *pci_name)
+{
+	return discover_pci_devices(state, pci_name);
+}
+
 int unparse_pci_name(char *buf, int size, const struct pci_dev *pdev)
 {
 	return snprintf(buf, size, "%04x:%02x:%02x.%x",
@@ -768,7 +1195,7 @@ static int unparse_smbios_type41_type(char *buf, const int size, const int type)
 int unparse_pci_device(char *buf, const int size, const struct pci_device *p)
 {
 	char *s = buf;
-	struct pci_device *dev;
+	unsigned int i;
 	char pci_name[16];
 	s += snprintf(s, size-(s-buf), "PCI name      : ");
 	s += unparse_pci_name(s,  size-(s-buf), p->pci_dev);
@@ -804,13 +1231,17 @@ int unparse_pci_device(char *buf, const int size, const struct pci_device *p)
 			s += snprintf(s, size-(s-buf), " count %d\n", p->vpd_pf->vpd_count);
 		}
 	}
-	if (!list_empty(&p->vfs)) {
+	if (p->is_sriov_physical_function) {
 		s += snprintf(s, size-(s-buf), "Virtual Functions:\n");
-		list_for_each_entry(dev, &p->vfs, vfnode) {
-			unparse_pci_name(pci_name, sizeof(pci_name), dev->pci_dev);
+		for (i=p->sriov->num_vfs; i--; ) {
+			if (!p->sriov->vf[i].pci_dev)
+				continue;
+			unparse_pci_name(pci_name, sizeof(pci_name), p->sriov->vf[i].pci_dev);
 			s += snprintf(s, size-(s-buf), "%s\n", pci_name);
 		}
 	}
+	if (profile_enabled)
+		s += unparse_cost(s, size-(s-buf), p->cost);
 
 	return (s-buf);
 }
@@ -818,18 +1249,14 @@ int unparse_pci_device(char *buf, const int size, const struct pci_device *p)
 struct pci_device * find_dev_by_pci(const struct libbiosdevname_state *state,
 				    const struct pci_dev *p)
 {
-	struct pci_device *dev;
-	list_for_each_entry(dev, &state->pci_devices, node) {
-		if (is_same_pci(p, dev->pci_dev))
-			return dev;
-	}
-	return NULL;
+	return find_pci_dev_by_pci_addr(state, pci_domain_nr(p), p->bus, p->dev, p->func);
 }
 
 struct pci_device * find_pci_dev_by_pci_addr(const struct libbiosdevname_state *state,
 					     const int domain, const int bus, const int device, const int func)
 {
 	struct pci_device *dev;
+	struct list_head *bucket;
 	struct pci_dev p;
 	memset(&p, 0, sizeof(p));
 
@@ -840,7 +1267,15 @@ struct pci_device * find_pci_dev_by_pci_addr(const struct libbiosdevname_state *
 	p.dev = device;
 	p.func = func;
 
-	list_for_each_entry(dev, &state->pci_devices, node) {
+	if (!state->pci_by_addr.size) {
+		list_for_each_entry(dev, &state->pci_devices, node) {
+			if (is_same_pci(&p, dev->pci_dev))
+				return dev;
+		}
+		return NULL;
+	}
+	bucket = hash_bucket(&state->pci_by_addr, hash_pci_addr(domain, bus, device, func));
+	list_for_each_entry(dev, bucket, addr_node) {
 		if (is_same_pci(&p, dev->pci_dev))
 			return dev;
 	}
@@ -857,6 +1292,383 @@ struct pci_device * find_dev_by_pci_name(const struct libbiosdevname_state *stat
 	return find_pci_dev_by_pci_addr(state, domain, bus, device, func);
 }
 
+/*
+ * The function a netdev with this bus_info takes its slot from: the
+ * function itself, or the PF when it's an SR-IOV VF.
+ */
+struct pci_device * find_slot_dev_by_pci_name(const struct libbiosdevname_state *state,
+					      const char *s)
+{
+	struct pci_device *dev;
+	struct pci_vf *vf;
+
+	dev = find_dev_by_pci_name(state, s);
+	if (dev)
+		return dev;
+	vf = find_vf_by_pci_name(state, s);
+	if (vf && vf->pci_dev)
+		return vf->pf;
+	return NULL;
+}
+
+struct pci_vf * find_vf_by_pci_name(const struct libbiosdevname_state *state,
+				    const char *s)
+{
+	int domain=0, bus=0, device=0, func=0;
+	struct pci_dev p;
+
+	if (parse_pci_name(s, &domain, &bus, &device, &func))
+		return NULL;
+	memset(&p, 0, sizeof(p));
+#ifdef HAVE_STRUCT_PCI_DEV_DOMAIN
+	p.domain = domain;
+#endif
+	p.bus = bus;
+	p.dev = device;
+	p.func = func;
+	return find_vf_by_pci(state, &p);
+}
+
+/*
+ * Where SMBIOS can record what it says about a VF.  VFs only get a
+ * pci_device once a netdev binds, so their records are kept apart, and
+ * only for VFs the bus scan found.
+ */
+struct pci_device * find_vf_smbios_record(const struct libbiosdevname_state *state,
+					  int domain, int bus, int device, int func)
+{
+	struct pci_device *rec;
+	struct pci_vf *vf;
+	struct pci_dev p;
+
+	memset(&p, 0, sizeof(p));
+#ifdef HAVE_STRUCT_PCI_DEV_DOMAIN
+	p.domain = domain;
+#endif
+	p.bus = bus;
+	p.dev = device;
+	p.func = func;
+	vf = find_vf_by_pci(state, &p);
+	if (!vf || !vf->pci_dev)
+		return NULL;
+	if (vf->smbios)
+		return vf->smbios;
+	rec = malloc(sizeof(*rec));
+	if (!rec)
+		return NULL;
+	memset(rec, 0, sizeof(*rec));
+	INIT_LIST_HEAD(&rec->node);
+	INIT_LIST_HEAD(&rec->addr_node);
+	INIT_LIST_HEAD(&rec->ports);
+	rec->pci_dev = vf->pci_dev;
+	rec->class = vf->pf->class;
+	rec->sbus = -1;
+	rec->physical_slot = PHYSICAL_SLOT_UNKNOWN;
+	rec->smbios_slot = PHYSICAL_SLOT_UNKNOWN;
+	rec->vpd_port = INT_MAX;
+	rec->vpd_pfi = INT_MAX;
+	vf->smbios = rec;
+	return rec;
+}
+
+/*
+ * Hotplug.  A function coming or going only changes what SMBIOS, VPD
+ * and the slot walk say about its own bus: SMBIOS records and VPD
+ * master functions are matched by address, and parents on other buses
+ * keep their slots.  Port order can still move in other slots, so the
+ * indexes are redone everywhere, which costs no I/O.
+ */
+
+/* libpci's record of a function; a replayed capture can only reuse the scanned ones */
+static struct pci_dev *hotplug_get_pci_dev(struct pci_access *pacc,
+					   int domain, int bus, int device, int func)
+{
+	struct pci_dev *p;
+
+	for (p=pacc->devices; p; p=p->next) {
+		if (pci_domain_nr(p) == domain && p->bus == bus &&
+		    p->dev == device && p->func == func)
+			return p;
+	}
+	p = pci_get_dev(pacc, domain, bus, device, func);
+	if (!p)
+		return NULL;
+	pci_fill_info(p, PCI_FILL_IDENT | PCI_FILL_CLASS);
+	p->next = pacc->devices;
+	pacc->devices = p;
+	return p;
+}
+
+static void hotplug_put_pci_dev(struct libbiosdevname_state *state, struct pci_dev *p)
+{
+	struct pci_dev **pp;
+
+	/* a capture's config space only exists in its dump, so keep it there */
+	if (*state->config.sysroot)
+		return;
+	for (pp=&state->pacc->devices; *pp; pp=&(*pp)->next) {
+		if (*pp == p) {
+			*pp = p->next;
+			pci_free_dev(p);
+			return;
+		}
+	}
+}
+
+static void hash_vfs(struct libbiosdevname_state *state, struct pci_sriov *sriov)
+{
+	struct pci_vf *vf;
+	unsigned int i;
+
+	if (!state->vfs_by_addr.size &&
+	    hash_table_init(&state->vfs_by_addr, sriov->num_vfs))
+		return;
+	for (i=0; i<sriov->num_vfs; i++) {
+		vf = &sriov->vf[i];
+		if (vf->domain < 0)
+			continue;
+		list_add_tail(&vf->addr_node,
+			      hash_bucket(&state->vfs_by_addr,
+					  hash_pci_addr(vf->domain, vf->bus, vf->device, vf->func)));
+	}
+}
+
+static void unhash_vfs(struct pci_sriov *sriov)
+{
+	unsigned int i;
+
+	for (i=0; i<sriov->num_vfs; i++)
+		list_del_init(&sriov->vf[i].addr_node);
+}
+
+/* sriov_numvfs was written: describe the VFs again, keeping the ones already known */
+static void refresh_sriov(struct libbiosdevname_state *state, struct pci_device *pf)
+{
+	struct pci_sriov *old = pf->sriov, *sriov;
+	struct pci_vf *vf;
+	unsigned int i;
+
+	sriov = read_sriov(state->config.sysroot, pf->pci_dev);
+	if (!sriov)
+		return;
+	for (i=0; i<sriov->num_vfs; i++) {
+		vf = &sriov->vf[i];
+		vf->pf = pf;
+		if (!old || i >= old->num_vfs || old->vf[i].domain != vf->domain ||
+		    old->vf[i].bus != vf->bus || old->vf[i].device != vf->device ||
+		    old->vf[i].func != vf->func)
+			continue;
+		vf->pci_dev = old->vf[i].pci_dev;
+		vf->dev = old->vf[i].dev;
+		vf->smbios = old->vf[i].smbios;
+		old->vf[i].dev = NULL;
+		old->vf[i].smbios = NULL;
+	}
+	if (old) {
+		unhash_vfs(old);
+		free_sriov(old);
+	}
+	pf->sriov = sriov;
+	hash_vfs(state, sriov);
+}
+
+static struct pci_device *read_physfn(struct libbiosdevname_state *state, const char *pci_name)
+{
+	char path[PATH_MAX], link[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/physfn", state->config.sysroot, pci_name);
+	memset(link, 0, sizeof(link));
+	if (io_readlink(path, link, sizeof(link)-1) < 0)
+		return NULL;
+	return find_dev_by_pci_name(state, link);
+}
+
+static void set_sriov_pf(struct pci_device *pf)
+{
+	unsigned int i;
+
+	pf->is_sriov_physical_function = 0;
+	for (i=0; pf->sriov && i<pf->sriov->num_vfs; i++) {
+		if (pf->sriov->vf[i].pci_dev)
+			pf->is_sriov_physical_function = 1;
+	}
+}
+
+/* VFs worked out their slot when they got a pci_device */
+static void update_vf_devices(struct libbiosdevname_state *state, struct pci_device *pf)
+{
+	struct pci_device *dev;
+	unsigned int i;
+
+	for (i=0; pf->sriov && i<pf->sriov->num_vfs; i++) {
+		dev = pf->sriov->vf[i].dev;
+		if (!dev)
+			continue;
+		set_vf_smbios(dev, &pf->sriov->vf[i]);
+		set_vf_slot(state, dev);
+	}
+}
+
+/* Forget what firmware and VPD said about a function before its bus is redone */
+static void reset_pci_device(struct pci_device *dev)
+{
+	struct pci_port *port, *n;
+
+	list_for_each_entry_safe(port, n, &dev->ports, node) {
+		list_del(&port->node);
+		free(port);
+	}
+	free(dev->smbios_label);
+	dev->smbios_label = NULL;
+	dev->uses_smbios = 0;
+	dev->smbios_type = 0;
+	dev->smbios_instance = 0;
+	dev->smbios_enabled = 0;
+	dev->smbios_slot = PHYSICAL_SLOT_UNKNOWN;
+	dev->physical_slot = PHYSICAL_SLOT_UNKNOWN;
+	dev->slot_source = SLOT_SOURCE_NONE;
+	dev->slot_parent = NULL;
+	dev->slot_evaluated = 0;
+	dev->vpd_count = 0;
+	dev->vpd_port = INT_MAX;
+	dev->vpd_pfi = INT_MAX;
+	dev->vpd_pf = NULL;
+	dev->vpd_read = 0;
+	dev->index_in_slot = 0;
+	dev->embedded_index = 0;
+	dev->embedded_index_valid = 0;
+}
+
+static void rescan_bus(struct libbiosdevname_state *state, int domain, int bus,
+		       struct slot_set *changed)
+{
+	struct pci_device *dev;
+
+	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (!on_bus(dev, domain, bus))
+			continue;
+		if (is_pci_network(dev))
+			slot_set_add(changed, dev->physical_slot);
+		reset_pci_device(dev);
+	}
+	state->rescan_domain = domain;
+	state->rescan_bus = bus;
+	state->smbios_decoded = 0;
+	decode_smbios(state);
+	state->rescan_domain = -1;
+	state->rescan_bus = -1;
+	set_pci_vpd_instance(state, domain, bus);
+	list_for_each_entry(dev, &state->pci_devices, node) {
+		if (!on_bus(dev, domain, bus) || !is_pci_network(dev))
+			continue;
+		dev_to_slot(state, dev);
+		slot_set_add(changed, dev->physical_slot);
+		update_vf_devices(state, dev);
+	}
+	set_embedded_index(state, changed);
+	set_pci_slot_index(state, changed);
+}
+
+/*
+ * Add a function the kernel just announced.  Slots whose names may have
+ * changed are added to changed.
+ */
+int pci_hotplug_add(struct libbiosdevname_state *state, const char *pci_name,
+		    struct slot_set *changed)
+{
+	int domain=0, bus=0, device=0, func=0;
+	struct pci_device *dev, *pf;
+	struct pci_vf *vf;
+	struct pci_dev *p;
+	unsigned int i;
+
+	if (!state->pacc || parse_pci_name(pci_name, &domain, &bus, &device, &func))
+		return 1;
+	if (find_pci_dev_by_pci_addr(state, domain, bus, device, func))
+		return 0;
+	vf = find_vf_by_pci_name(state, pci_name);
+	if (!vf && (pf = read_physfn(state, pci_name)) != NULL) {
+		refresh_sriov(state, pf);
+		vf = find_vf_by_pci_name(state, pci_name);
+	}
+	if (vf && vf->pci_dev)
+		return 0;
+	p = hotplug_get_pci_dev(state->pacc, domain, bus, device, func);
+	if (!p)
+		return 1;
+	if (vf) {
+		vf->pci_dev = p;
+		vf->pf->is_sriov_physical_function = 1;
+		slot_set_add(changed, vf->pf->physical_slot);
+		return 0;
+	}
+
+	dev = add_pci_dev(state, p);
+	if (!dev)
+		return 1;
+	list_del_init(&dev->node);
+	insertion_sort_devices(dev, &state->pci_devices, sort_pci);
+	dev->sriov = read_sriov(state->config.sysroot, p);
+	if (dev->sriov) {
+		for (i=0; i<dev->sriov->num_vfs; i++)
+			dev->sriov->vf[i].pf = dev;
+		hash_vfs(state, dev->sriov);
+	}
+	rescan_bus(state, domain, bus, changed);
+	return 0;
+}
+
+/*
+ * Drop a function the kernel removed.  The caller has already dropped
+ * the bios_devices of it and of its VFs.
+ */
+int pci_hotplug_remove(struct libbiosdevname_state *state, const char *pci_name,
+		       struct slot_set *changed)
+{
+	struct pci_device *dev, *d;
+	struct pci_vf *vf;
+	int domain, bus;
+	unsigned int i;
+
+	if (!state->pacc)
+		return 1;
+	vf = find_vf_by_pci_name(state, pci_name);
+	if (vf && vf->pci_dev) {
+		slot_set_add(changed, vf->pf->physical_slot);
+		if (vf->dev)
+			free_pci_device(vf->dev);
+		vf->dev = NULL;
+		hotplug_put_pci_dev(state, vf->pci_dev);
+		vf->pci_dev = NULL;
+		set_sriov_pf(vf->pf);
+		return 0;
+	}
+	dev = find_dev_by_pci_name(state, pci_name);
+	if (!dev)
+		return 0;
+	slot_set_add(changed, dev->physical_slot);
+	list_for_each_entry(d, &state->pci_devices, node) {
+		if (d->slot_parent == dev)
+			d->slot_parent = NULL;
+	}
+	if (dev->sriov) {
+		unhash_vfs(dev->sriov);
+		for (i=0; i<dev->sriov->num_vfs; i++) {
+			if (dev->sriov->vf[i].pci_dev)
+				hotplug_put_pci_dev(state, dev->sriov->vf[i].pci_dev);
+		}
+		free_sriov(dev->sriov);
+	}
+	domain = pci_domain_nr(dev->pci_dev);
+	bus = dev->pci_dev->bus;
+	list_del(&dev->node);
+	list_del(&dev->addr_node);
+	hotplug_put_pci_dev(state, dev->pci_dev);
+	free_pci_device(dev);
+	rescan_bus(state, domain, bus, changed);
+	return 0;
+}
+
 int is_root_port(const struct libbiosdevname_state *state,
 		int domain, int bus, int device, int func)
 {
@@ -873,7 +1685,7 @@ int is_root_port(const struct libbiosdevname_state *state,
        if (pos != 0) {
 	       u8 type;
 
-	       flag = pci_read_word(pdev->pci_dev, pos + PCI_EXP_FLAGS);
+	       flag = cfg_read_word(pdev->pci_dev, pos + PCI_EXP_FLAGS);
 
 	       type = (flag & PCI_EXP_FLAGS_TYPE) >> 4;
 
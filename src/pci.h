@@ -12,6 +12,7 @@
 #include "list.h"
 #include "state.h"
 #include "config.h"
+#include "profile.h"
 
 struct slotlist
 {
@@ -26,8 +27,36 @@ struct pci_port {
 	int pfi;
 };
 
+struct pci_device;
+
+/*
+ * A virtual function of an SR-IOV physical function.  VFs share slot,
+ * SMBIOS and port information with their PF, so they are kept in this
+ * compact form and only get a full pci_device once a netdev binds.
+ */
+struct pci_vf {
+	struct list_head addr_node;	/* in state->vfs_by_addr */
+	struct pci_device *pf;
+	struct pci_dev *pci_dev;	/* NULL until seen in the bus scan */
+	struct pci_device *dev;		/* NULL until a netdev binds */
+	struct pci_device *smbios;	/* what SMBIOS says of the VF itself, or NULL */
+	unsigned int vf_index;		/* virtfn<vf_index> */
+	int domain;
+	int bus;
+	int device;
+	int func;
+};
+
+struct pci_sriov {
+	unsigned int num_vfs;
+	unsigned int offset;	/* routing ID of VF0, relative to the PF */
+	unsigned int stride;	/* routing ID distance between VFs, 0 if unknown */
+	struct pci_vf *vf;	/* num_vfs entries */
+};
+
 struct pci_device {
 	struct list_head node;
+	struct list_head addr_node;	/* in state->pci_by_addr */
 	struct pci_dev *pci_dev;
 	int physical_slot;
 	unsigned int index_in_slot; /* only valid if physical_slot > 0 and not a VF */
@@ -38,6 +67,7 @@ struct pci_device {
 	unsigned char smbios_type;
 	unsigned char smbios_instance;
 	unsigned char smbios_enabled;
+	int smbios_slot;		/* physical_slot as SMBIOS gave it */
 	char *smbios_label;
 	unsigned int sysfs_index;
 	char * sysfs_label;
@@ -48,12 +78,16 @@ struct pci_device {
 	unsigned int vpd_port;
 	struct pci_device *vpd_pf;
 	struct pci_device *pf;
-	struct list_head vfnode;
-	struct list_head vfs;
+	struct pci_sriov *sriov;
 	struct list_head ports;
 	unsigned int is_sriov_physical_function:1;
 	unsigned int is_sriov_virtual_function:1;
 	unsigned int embedded_index_valid:1;
+	unsigned int slot_evaluated:1;
+	unsigned int vpd_read:1;	/* its bus has been through VPD */
+	int slot_source;		/* where physical_slot came from */
+	struct pci_device *slot_parent;	/* set when it came from an ancestor */
+	struct io_stats *cost;	/* per profile_source, while profiling */
 };
 
 #define HAS_SMBIOS_INSTANCE 1
@@ -61,19 +95,65 @@ struct pci_device {
 #define HAS_SMBIOS_SLOT  4
 #define HAS_SMBIOS_EXACT_MATCH 8
 
+/* SLOT_SOURCE_* are in libbiosdevname.h, for the device records */
+
+/* Slots whose names a hotplug event may have changed */
+#define SLOT_SET_MAX 8
+struct slot_set {
+	int all;
+	int n;
+	int slot[SLOT_SET_MAX];
+};
+
+static inline int slot_set_has(const struct slot_set *set, int slot)
+{
+	int i;
+
+	if (set->all)
+		return 1;
+	for (i=0; i<set->n; i++) {
+		if (set->slot[i] == slot)
+			return 1;
+	}
+	return 0;
+}
+
+static inline void slot_set_add(struct slot_set *set, int slot)
+{
+	if (slot_set_has(set, slot))
+		return;
+	if (set->n == SLOT_SET_MAX)
+		set->all = 1;
+	else
+		set->slot[set->n++] = slot;
+}
+
 #define HAS_SYSFS_INDEX 1
 #define HAS_SYSFS_LABEL 2
 #define PHYSICAL_SLOT_UNKNOWN (INT_MAX)
+
+/* Config space dump kept at the top of a capture directory */
+#define PCI_DUMP_FILE "lspci.txt"
 #define INDEX_IN_SLOT_UNKNOWN (INT_MAX)
 
 extern int get_pci_devices(struct libbiosdevname_state *state);
+extern int get_pci_devices_for(struct libbiosdevname_state *state, const char *pci_name);
 extern void free_pci_devices(struct libbiosdevname_state *state);
 
 extern struct pci_device * find_dev_by_pci(const struct libbiosdevname_state *state, const struct pci_dev *p);
 extern struct pci_device * find_pci_dev_by_pci_addr(const struct libbiosdevname_state *state, const int domain, const int bus, const int device, const int func);
 extern struct pci_device * find_dev_by_pci_name(const struct libbiosdevname_state *state, const char *s);
+extern struct pci_device * find_slot_dev_by_pci_name(const struct libbiosdevname_state *state, const char *s);
+extern struct pci_vf * find_vf_by_pci_name(const struct libbiosdevname_state *state, const char *s);
+extern struct pci_device * find_vf_smbios_record(const struct libbiosdevname_state *state, int domain, int bus, int device, int func);
+extern int pci_hotplug_add(struct libbiosdevname_state *state, const char *pci_name, struct slot_set *changed);
+extern int pci_hotplug_remove(struct libbiosdevname_state *state, const char *pci_name, struct slot_set *changed);
 extern int unparse_pci_device(char *buf, const int size, const struct pci_device *p);
 extern int unparse_pci_name(char *buf, int size, const struct pci_dev *pdev);
+extern struct pci_device * pci_vf_device(struct libbiosdevname_state *state, struct pci_vf *vf);
+extern void init_vf_device(struct libbiosdevname_state *state, struct pci_device *dev,
+			   const struct pci_vf *vf);
+extern int pci_device_slot(struct libbiosdevname_state *state, struct pci_device *dev);
 
 static inline int is_pci_network(struct pci_device *dev)
 {
@@ -15,33 +15,61 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <limits.h>
-#include <sys/mman.h>
 #include "pirq.h"
+#include "state.h"
+#include "legacy_bios.h"
 
-extern int nopirq;
 
 /* If unknown, use INT_MAX so they get sorted last */
-int pirq_pci_dev_to_slot(struct routing_table *table, int domain, int bus, int dev)
+int pirq_pci_dev_to_slot(const struct pirq_slot_map *map, int domain, int bus, int dev)
 {
-	int i, num_slots;
-	struct slot_entry *slot;
+	int slot;
 
-	if (!table)
+	if (!map)
 		return INT_MAX;
 	if (domain != 0) /* can't represent non-zero domains in PIRQ */
 		return INT_MAX;
+	if (bus < 0 || bus >= PIRQ_MAX_BUS || dev < 0 || dev >= PIRQ_MAX_DEV)
+		return INT_MAX;
+
+	slot = map->slot[bus][dev];
+	if (slot == PIRQ_SLOT_NONE)
+		return INT_MAX;
+	if (slot >= '1' && slot <= '9')
+		return slot - '0';
+	return slot;
+}
+
+/*
+ * Convert the raw table into a bus/device indexed map so that lookups
+ * don't have to walk every slot entry.  The first entry for a given
+ * bus/device wins, just as it did with the linear scan.
+ */
+struct pirq_slot_map *pirq_alloc_slot_map(const struct routing_table *table)
+{
+	struct pirq_slot_map *map;
+	const struct slot_entry *slot;
+	int i, num_slots;
+
+	if (!table)
+		return NULL;
+	map = malloc(sizeof(*map));
+	if (!map)
+		return NULL;
+	memset(map, 0xFF, sizeof(*map));
 
 	num_slots = (table->size - 32) / sizeof(*slot);
 	for (i=0; i<num_slots; i++) {
 		slot = &table->slot[i];
-		if (slot->bus == bus &&
-		    PCI_DEVICE(slot->device) == dev) {
-		  	if (slot->slot >= '1' && slot->slot <= '9')
-				return slot->slot - '0';
-			return slot->slot;
-		}
+		if (map->slot[slot->bus][PCI_DEVICE(slot->device)] == PIRQ_SLOT_NONE)
+			map->slot[slot->bus][PCI_DEVICE(slot->device)] = slot->slot;
 	}
-	return INT_MAX;
+	return map;
+}
+
+void pirq_free_slot_map(struct pirq_slot_map *map)
+{
+	free(map);
 }
 
 struct routing_table *pirq_read_file()
@@ -92,66 +120,50 @@ struct routing_table *pirq_read_file()
 	return NULL;
 }
 
-struct routing_table * pirq_alloc_read_table()
+struct routing_table * pirq_alloc_read_table(struct libbiosdevname_state *state)
 {
-	struct routing_table *table = NULL;
+	struct routing_table *table = NULL, *pir;
+	struct legacy_bios_area *area;
 	uint16_t size = 0;
 	uint8_t checksum = 0;
-	int i;
-	void *mem;
-	off_t offset=0L;
-	int fd;
+	int i, j;
 
 	/* Skip PIRQ table parsing */
-	if (nopirq) {
+	if (state->config.nopirq) {
 		return NULL;
 	}
 	if ((table = pirq_read_file()) != NULL)
 		return table;
 
-	fd = open("/dev/mem", O_RDONLY);
-	if(fd==-1)
+	area = legacy_bios_area(state);
+	if (!area)
 		return NULL;
 
-	mem = mmap(0, 64*1024, PROT_READ, MAP_SHARED, fd, 0xF0000L);
-	if (mem == (void *)-1LL)
-		goto out;
-
-	while( offset < 0xFFFF)
-	{
-		if(memcmp(mem+offset, "$PIR", 4)==0)
-		{
-			table = (struct routing_table *)(mem+offset);
-			size = table->size;
-			/* quick sanity checks */
-			if (size == 0) {
-				table = NULL;
-				break;
-			}
-			/* Version must be 1.0 */
-			if (!((table->version >> 8) == 1 &&
-			      (table->version & 0xFF) == 0)) {
-				table = NULL;
-				break;
-			}
+	for (i=0; i<area->count; i++) {
+		if (area->anchor[i].type != ANCHOR_PIR)
+			continue;
+		pir = (struct routing_table *)(area->mem + area->anchor[i].offset);
+		size = pir->size;
+		/* quick sanity checks */
+		if (size == 0 || size > LEGACY_BIOS_SIZE - area->anchor[i].offset)
+			break;
+		/* Version must be 1.0 */
+		if (!((pir->version >> 8) == 1 &&
+		      (pir->version & 0xFF) == 0))
+			break;
 
-			table = malloc(size);
-			if (!table) break;
+		table = malloc(size);
+		if (!table) break;
 
-			memcpy(table, mem+offset, size);
-			for (i=0; i<size; i++)
-				checksum +=*(((uint8_t *)table)+i);
-			if (checksum) {
-				free (table);
-				table = NULL;
-			}
-			break;
+		memcpy(table, pir, size);
+		for (j=0; j<size; j++)
+			checksum +=*(((uint8_t *)table)+j);
+		if (checksum) {
+			free (table);
+			table = NULL;
 		}
-		offset += 16;
+		break;
 	}
-	munmap(mem, 64*1024);
-out:
-	close(fd);
 	return table;
 }
 
@@ -202,8 +214,12 @@ pirq_unparse_routing_table(struct routing_table *table)
 
 int main(int argc, char *argv[])
 {
+	struct libbiosdevname_state state;
 	struct routing_table *table;
-	table = pirq_alloc_read_table();
+	memset(&state, 0, sizeof(state));
+	state.config.sysroot = "";
+	table = pirq_alloc_read_table(&state);
+	legacy_bios_free(state.bios_area);
 	if (!table)
 		return 1;
 	pirq_unparse_routing_table(table);
@@ -51,8 +51,21 @@ struct routing_table {
 
 #define PCI_DEVICE(devfn)         (((devfn) >> 3) & 0x1f)
 #define PCI_FUNC(devfn)         ((devfn) & 0x07)
-extern struct routing_table * pirq_alloc_read_table(void);
+
+#define PIRQ_MAX_BUS	256
+#define PIRQ_MAX_DEV	32
+#define PIRQ_SLOT_NONE	0xFFFF
+
+/* $PIR slot numbers indexed by bus and device */
+struct pirq_slot_map {
+	__u16 slot[PIRQ_MAX_BUS][PIRQ_MAX_DEV];
+};
+
+struct libbiosdevname_state;
+extern struct routing_table * pirq_alloc_read_table(struct libbiosdevname_state *state);
 extern void pirq_free_table(struct routing_table *table);
-extern int pirq_pci_dev_to_slot(struct routing_table *table, int domain, int bus, int dev);
+extern struct pirq_slot_map * pirq_alloc_slot_map(const struct routing_table *table);
+extern void pirq_free_slot_map(struct pirq_slot_map *map);
+extern int pirq_pci_dev_to_slot(const struct pirq_slot_map *map, int domain, int bus, int dev);
 
 #endif /* PIRQ_H_INCLUDED */
@@ -0,0 +1,287 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+#include "trace.h"
+
+int profile_enabled;
+
+struct profile_stat {
+	const char *name;
+	unsigned int calls;
+	unsigned int items;	/* what "items" means depends on the phase */
+	unsigned long long ns;
+	unsigned long long start;
+	int depth;
+	struct io_stats io;
+};
+
+static struct profile_stat stats[PROFILE_PHASES] = {
+	[PROFILE_VF_CACHE]	= { "vf_cache" },
+	[PROFILE_PCI_SCAN]	= { "pci_scan_bus" },
+	[PROFILE_SRIOV]		= { "scan_sriov" },
+	[PROFILE_ADD_PCI]	= { "add_pci_dev" },
+	[PROFILE_SMBIOS]	= { "dmidecode" },
+	[PROFILE_SORT_PCI]	= { "sort_pci_devices" },
+	[PROFILE_SET_SRIOV]	= { "set_sriov" },
+	[PROFILE_VPD]		= { "set_pci_vpd_instance" },
+	[PROFILE_SLOTS]		= { "set_pci_slots" },
+	[PROFILE_PIRQ]		= { "  pirq_read_table" },
+	[PROFILE_INDEX]		= { "slot_index" },
+	[PROFILE_ETHS]		= { "get_eths" },
+	[PROFILE_MATCH]		= { "match_all" },
+	[PROFILE_SORT]		= { "sort_bios_devices" },
+	[PROFILE_NAMING]	= { "naming" },
+	[PROFILE_DUPLICATES]	= { "find_duplicates" },
+};
+
+static const char *io_names[IO_KINDS] = {
+	[IO_OPEN]	= "opens",
+	[IO_READ]	= "reads",
+	[IO_BYTES]	= "bytes",
+	[IO_READLINK]	= "readlinks",
+	[IO_IOCTL]	= "ioctls",
+	[IO_SOCKET]	= "sockets",
+	[IO_SCANDIR]	= "scandirs",
+	[IO_CONFIG]	= "config",
+};
+
+static unsigned long long first, last;
+static struct io_stats io_total;
+
+/* The device being worked on, and the source its cost goes to */
+static struct io_stats *cur_cost;
+static enum profile_source cur_source;
+static unsigned long long cur_start;
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char *json_name(const char *name)
+{
+	while (*name == ' ')
+		name++;
+	return name;
+}
+
+void profile_begin(enum profile_phase phase)
+{
+	struct profile_stat *s = &stats[phase];
+
+	if (!profile_enabled)
+		return;
+	/* only the outermost entry of a recursive phase is timed */
+	if (s->depth++)
+		return;
+	s->start = now();
+	if (!first)
+		first = s->start;
+	trace_begin("phase", json_name(s->name));
+}
+
+void profile_end(enum profile_phase phase)
+{
+	struct profile_stat *s = &stats[phase];
+
+	if (!profile_enabled || !s->depth)
+		return;
+	if (--s->depth)
+		return;
+	last = now();
+	s->ns += last - s->start;
+	s->calls++;
+	trace_end();
+}
+
+void profile_items(enum profile_phase phase, unsigned int n)
+{
+	if (profile_enabled)
+		stats[phase].items += n;
+}
+
+/*
+ * Count I/O against every phase in progress, so nested phases are
+ * inclusive like their times, and against the device being worked on.
+ */
+void profile_io(enum profile_io kind, unsigned long long n)
+{
+	int i;
+
+	if (!profile_enabled)
+		return;
+	io_total.n[kind] += n;
+	for (i=0; i<PROFILE_PHASES; i++) {
+		if (stats[i].depth)
+			stats[i].io.n[kind] += n;
+	}
+	if (cur_cost)
+		cur_cost[cur_source].n[kind] += n;
+}
+
+/*
+ * Charge time and I/O to (*cost)[source] until profile_device_end().
+ * The cost array is only allocated when profiling, and the name is
+ * only formatted for --trace.  Device scopes don't nest.
+ */
+void profile_device_begin(struct io_stats **cost, enum profile_source source,
+			  const char *fmt, ...)
+{
+	char name[64];
+	va_list ap;
+
+	if (!profile_enabled)
+		return;
+	if (!*cost)
+		*cost = calloc(PROFILE_SOURCES, sizeof(**cost));
+	cur_cost = *cost;
+	cur_source = source;
+	cur_start = now();
+	if (trace_enabled) {
+		va_start(ap, fmt);
+		vsnprintf(name, sizeof(name), fmt, ap);
+		va_end(ap);
+		trace_begin("device", name);
+	}
+}
+
+static void charge_time(void)
+{
+	unsigned long long t = now();
+
+	cur_cost[cur_source].ns += t - cur_start;
+	cur_start = t;
+}
+
+void profile_device_end(void)
+{
+	if (!cur_cost)
+		return;
+	charge_time();
+	cur_cost = NULL;
+	trace_end();
+}
+
+/* Switch the current device to another source; returns the old one */
+enum profile_source profile_source(enum profile_source source)
+{
+	enum profile_source prev = cur_source;
+
+	if (!cur_cost)
+		return prev;
+	charge_time();
+	cur_source = source;
+	return prev;
+}
+
+void profile_phase_cost(enum profile_phase phase, struct io_stats *cost)
+{
+	*cost = stats[phase].io;
+	cost->ns = stats[phase].ns;
+}
+
+void io_stats_add(struct io_stats *to, const struct io_stats *from)
+{
+	int i;
+
+	for (i=0; i<IO_KINDS; i++)
+		to->n[i] += from->n[i];
+	to->ns += from->ns;
+}
+
+int unparse_io_stats(char *buf, const int size, const struct io_stats *io)
+{
+	char *s = buf;
+	int i;
+
+	s += snprintf(s, size-(s-buf), "%.3f ms", io->ns / 1e6);
+	for (i=0; i<IO_KINDS; i++) {
+		if (io->n[i])
+			s += snprintf(s, size-(s-buf), ", %s %llu", io_names[i], io->n[i]);
+	}
+	return (s-buf);
+}
+
+/* The I/O line of the -d dump, for a device's whole cost array */
+int unparse_cost(char *buf, const int size, const struct io_stats *cost)
+{
+	struct io_stats total;
+	char *s = buf;
+	int i;
+
+	if (!cost)
+		return 0;
+	memset(&total, 0, sizeof(total));
+	for (i=0; i<PROFILE_SOURCES; i++)
+		io_stats_add(&total, &cost[i]);
+	s += snprintf(s, size-(s-buf), "I/O: ");
+	s += unparse_io_stats(s, size-(s-buf), &total);
+	s += snprintf(s, size-(s-buf), "\n");
+	return (s-buf);
+}
+
+static void print_io_json(FILE *fp, const struct io_stats *io)
+{
+	int i;
+
+	for (i=0; i<IO_KINDS; i++)
+		fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", io_names[i], io->n[i]);
+}
+
+static void print_io(FILE *fp, const struct io_stats *io)
+{
+	int i;
+
+	for (i=0; i<IO_KINDS; i++)
+		fprintf(fp, " %*llu", i == IO_BYTES ? 9 : 7, io->n[i]);
+	fprintf(fp, "\n");
+}
+
+/*
+ * Times are inclusive, so nested phases (indented in the table) are
+ * also part of their parent's time and I/O.  The total runs from the
+ * first phase starting to the last one ending, and its I/O includes
+ * whatever was done outside any phase.
+ */
+void profile_print(FILE *fp, int json)
+{
+	double total = (last - first) / 1e6;
+	int i;
+
+	if (json) {
+		fprintf(fp, "{\"total_ms\": %.3f, \"io\": {", total);
+		print_io_json(fp, &io_total);
+		fprintf(fp, "}, \"phases\": [");
+		for (i=0; i<PROFILE_PHASES; i++) {
+			fprintf(fp, "%s\n  {\"name\": \"%s\", \"calls\": %u, \"items\": %u, \"ms\": %.3f, \"io\": {",
+				i ? "," : "", json_name(stats[i].name),
+				stats[i].calls, stats[i].items, stats[i].ns / 1e6);
+			print_io_json(fp, &stats[i].io);
+			fprintf(fp, "}}");
+		}
+		fprintf(fp, "\n]}\n");
+		return;
+	}
+	fprintf(fp, "%-22s %6s %8s %10s %6s %7s %7s %9s %7s %7s %7s %7s %7s\n",
+		"phase", "calls", "items", "ms", "%", "opens", "reads", "bytes",
+		"rdlinks", "ioctls", "sockets", "scandir", "config");
+	for (i=0; i<PROFILE_PHASES; i++) {
+		fprintf(fp, "%-22s %6u %8u %10.3f %6.1f", stats[i].name,
+			stats[i].calls, stats[i].items, stats[i].ns / 1e6,
+			total > 0 ? stats[i].ns / 1e6 * 100 / total : 0.0);
+		print_io(fp, &stats[i].io);
+	}
+	fprintf(fp, "%-22s %6s %8s %10.3f %6s", "total", "", "", total, "");
+	print_io(fp, &io_total);
+}
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include <stdio.h>
+
+/* Phases of setup_bios_devices(), in the order they run */
+enum profile_phase {
+	PROFILE_VF_CACHE,	/* vf_cache_lookup() */
+	PROFILE_PCI_SCAN,	/* pci_scan_bus() */
+	PROFILE_SRIOV,		/* scan_sriov() */
+	PROFILE_ADD_PCI,	/* add_pci_dev() for the rest */
+	PROFILE_SMBIOS,		/* dmidecode_main() */
+	PROFILE_SORT_PCI,	/* sort_device_list() of PCI devices */
+	PROFILE_SET_SRIOV,	/* set_sriov() */
+	PROFILE_VPD,		/* set_pci_vpd_instance() */
+	PROFILE_SLOTS,		/* set_pci_slots() */
+	PROFILE_PIRQ,		/* $PIR load, nested in PROFILE_SLOTS */
+	PROFILE_INDEX,		/* set_embedded_index(), set_pci_slot_index() */
+	PROFILE_ETHS,		/* get_eths() */
+	PROFILE_MATCH,		/* match_all() */
+	PROFILE_SORT,		/* sort_device_list() of bios devices */
+	PROFILE_NAMING,		/* assign_bios_network_names() */
+	PROFILE_DUPLICATES,	/* find_duplicates() */
+	PROFILE_PHASES
+};
+
+/* I/O counted through the io.h wrappers and the config space reads in pci.c */
+enum profile_io {
+	IO_OPEN,
+	IO_READ,
+	IO_BYTES,
+	IO_READLINK,
+	IO_IOCTL,
+	IO_SOCKET,
+	IO_SCANDIR,
+	IO_CONFIG,	/* PCI config space reads */
+	IO_KINDS
+};
+
+struct io_stats {
+	unsigned long long n[IO_KINDS];
+	unsigned long long ns;
+};
+
+/* What the time and I/O for one device were spent on */
+enum profile_source {
+	SOURCE_PCI,		/* config space in add_pci_dev() */
+	SOURCE_SYSFS,		/* sysfs index and label */
+	SOURCE_SRIOV,		/* sriov_* attributes and virtfn links */
+	SOURCE_VPD,		/* Dell VPD-R */
+	SOURCE_PCIE_SLOT,	/* PCIe slot capability */
+	SOURCE_PARENT,		/* find_parent() */
+	SOURCE_PIRQ,		/* $PIR, including loading it */
+	SOURCE_NETDEV,		/* ioctls, sysfs and saved ethtool data */
+	PROFILE_SOURCES
+};
+
+/*
+ * Profiling and tracing are process-wide, for biosdevname --profile and
+ * --trace, which run one discovery at a time.  The library never turns
+ * them on, and while they are off nothing here writes shared state.
+ */
+extern int profile_enabled;
+
+extern void profile_begin(enum profile_phase phase);
+extern void profile_end(enum profile_phase phase);
+extern void profile_items(enum profile_phase phase, unsigned int n);
+extern void profile_print(FILE *fp, int json);
+
+extern void profile_io(enum profile_io kind, unsigned long long n);
+extern void profile_device_begin(struct io_stats **cost, enum profile_source source,
+				 const char *fmt, ...);
+extern void profile_device_end(void);
+extern enum profile_source profile_source(enum profile_source source);
+extern void profile_phase_cost(enum profile_phase phase, struct io_stats *cost);
+extern void io_stats_add(struct io_stats *to, const struct io_stats *from);
+extern int unparse_io_stats(char *buf, const int size, const struct io_stats *io);
+extern int unparse_cost(char *buf, const int size, const struct io_stats *cost);
+
+#endif /* PROFILE_H_INCLUDED */
@@ -12,12 +12,15 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 #include "eths.h"
+#include "sysfs.h"
+#include "io.h"
 
 #define _PATH_PROCNET_DEV "/proc/net/dev"
 
-static struct network_device *add_interface(struct libbiosdevname_state *state,
-					    const char *name)
+struct network_device *add_interface(struct libbiosdevname_state *state,
+				     const char *name)
 {
 	struct network_device *i;
 	i = malloc(sizeof(*i));
@@ -25,8 +28,11 @@ static struct network_device *add_interface(struct libbiosdevname_state *state,
 		return NULL;
 	memset(i, 0, sizeof(*i));
 	INIT_LIST_HEAD(&i->node);
+	INIT_LIST_HEAD(&i->bus_info_node);
+	INIT_LIST_HEAD(&i->name_node);
 	strncpy(i->kernel_name, name, sizeof(i->kernel_name)-1);
 	list_add_tail(&i->node, &state->network_devices);
+	hash_eth_name(state, i);
 	return i;
 }
 
@@ -77,21 +83,23 @@ int get_interfaces(struct libbiosdevname_state *state)
 	int err;
 	char *line = NULL;
 	size_t linelen = 0;
+	char path[PATH_MAX];
 
-	fh = fopen(_PATH_PROCNET_DEV, "r");
+	snprintf(path, sizeof(path), "%s%s", state->config.sysroot, _PATH_PROCNET_DEV);
+	fh = io_fopen(path, "r");
 	if (!fh) {
 		fprintf(stderr, "Error: cannot open %s (%s).\n",
-			_PATH_PROCNET_DEV, strerror(errno));
+			path, strerror(errno));
 		return 1;
 	}
-	if (getline(&line, &linelen, fh) == -1 /* eat line */
-	    || getline(&line, &linelen, fh) == -1) {
+	if (io_getline(&line, &linelen, fh) == -1 /* eat line */
+	    || io_getline(&line, &linelen, fh) == -1) {
 		err = -1;
 		goto out;
 	}
 
 	err = 0;
-	while (getline(&line, &linelen, fh) != -1) {
+	while (io_getline(&line, &linelen, fh) != -1) {
 		char *name;
 		get_name(&name, line);
 		add_interface(state, name);
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Give every interface its BIOS name in one process, over one rtnetlink
+ * socket, instead of one udev event at a time.  An interface whose new
+ * name is still held by another one waits for that one to move; when
+ * every remaining rename waits on another (eth0 -> eth1 -> eth0), one of
+ * them is first moved out of the way to a temporary name.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include "bios_device.h"
+#include "eths.h"
+#include "state.h"
+#include "hash.h"
+#include "libbiosdevname.h"
+
+struct rename {
+	struct list_head node;	/* in the by-ifindex table */
+	struct bios_device *dev;
+	int done;
+};
+
+struct rtnl {
+	const char *sysroot;
+	int fd;
+	unsigned int seq;
+};
+
+static int rtnl_open(struct rtnl *rtnl, const char *sysroot)
+{
+	rtnl->sysroot = sysroot;
+	rtnl->seq = 0;
+	rtnl->fd = -1;
+	if (*sysroot)
+		return 0;
+	rtnl->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	return rtnl->fd < 0;
+}
+
+static void rtnl_close(struct rtnl *rtnl)
+{
+	if (rtnl->fd >= 0)
+		close(rtnl->fd);
+}
+
+static int rtnl_rename(struct rtnl *rtnl, int ifindex, const char *name)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct ifinfomsg ifi;
+		char attrs[RTA_SPACE(IFNAMSIZ)];
+	} req;
+	struct {
+		struct nlmsghdr nh;
+		struct nlmsgerr err;
+		char rest[256];
+	} ack;
+	struct rtattr *rta;
+	ssize_t len;
+
+	/* a capture's interfaces only get renamed in the state */
+	if (*rtnl->sysroot)
+		return 0;
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+	req.nh.nlmsg_type = RTM_NEWLINK;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	req.nh.nlmsg_seq = ++rtnl->seq;
+	req.ifi.ifi_family = AF_UNSPEC;
+	req.ifi.ifi_index = ifindex;
+	rta = (struct rtattr *)((char *)&req + NLMSG_ALIGN(req.nh.nlmsg_len));
+	rta->rta_type = IFLA_IFNAME;
+	rta->rta_len = RTA_LENGTH(strlen(name) + 1);
+	memcpy(RTA_DATA(rta), name, strlen(name) + 1);
+	req.nh.nlmsg_len = NLMSG_ALIGN(req.nh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+
+	if (send(rtnl->fd, &req, req.nh.nlmsg_len, 0) < 0)
+		return -1;
+	for (;;) {
+		len = recv(rtnl->fd, &ack, sizeof(ack), 0);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			return -1;
+		if (len < (ssize_t)NLMSG_LENGTH(sizeof(ack.err)) ||
+		    ack.nh.nlmsg_type != NLMSG_ERROR || ack.nh.nlmsg_seq != rtnl->seq)
+			continue;
+		if (ack.err.error) {
+			errno = -ack.err.error;
+			return -1;
+		}
+		return 0;
+	}
+}
+
+/* Rename dev's interface, in the kernel and in the state */
+static int rename_one(struct libbiosdevname_state *state, struct rtnl *rtnl, struct bios_device *dev,
+		      const char *name, bios_name_changed_fn renamed, void *arg)
+{
+	struct network_device *n = dev->netdev;
+	char old[IFNAMSIZ];
+
+	if (rtnl_rename(rtnl, n->ifindex, name)) {
+		fprintf(stderr, "Cannot rename %s to %s: %s\n", n->kernel_name, name,
+			strerror(errno));
+		return 1;
+	}
+	strcpy(old, n->kernel_name);
+	unhash_bios_device(dev);
+	rename_eth(state, n, name);
+	hash_bios_device(state, dev);
+	if (renamed)
+		renamed(old, n->kernel_name, arg);
+	return 0;
+}
+
+static struct rename *find_rename(const struct hash_table *t, const struct network_device *n)
+{
+	struct rename *r;
+
+	list_for_each_entry(r, hash_bucket(t, hash_int(n->ifindex)), node)
+		if (!r->done && r->dev->netdev == n)
+			return r;
+	return NULL;
+}
+
+/*
+ * Rename every interface that has a BIOS name, other than duplicates,
+ * to that name.  renamed() is called with the old and new kernel name
+ * of each rename done, temporary ones included.  Returns the number of
+ * interfaces that could not be renamed, or -1 before renaming any when
+ * there is no state, memory or rtnetlink socket.
+ */
+int rename_bios_devices(void *cookie, bios_name_changed_fn renamed, void *arg)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct network_device *holder;
+	struct bios_device *dev;
+	struct rename *r;
+	struct hash_table by_ifindex;
+	struct rtnl rtnl;
+	char tmp[IFNAMSIZ];
+	int i, count = 0, left, progress, failed = 0;
+
+	if (!state)
+		return -1;
+	list_for_each_entry(dev, &state->bios_devices, node)
+		count++;
+	r = calloc(count ? count : 1, sizeof(*r));
+	if (!r)
+		return -1;
+	count = 0;
+	list_for_each_entry(dev, &state->bios_devices, node) {
+		if (!dev->netdev || !dev->bios_name || dev->duplicate ||
+		    !strcmp(dev->netdev->kernel_name, dev->bios_name))
+			continue;
+		r[count++].dev = dev;
+	}
+	if (!count) {
+		free(r);
+		return 0;
+	}
+	if (hash_table_init(&by_ifindex, count)) {
+		free(r);
+		return -1;
+	}
+	for (i=0; i<count; i++)
+		list_add_tail(&r[i].node, hash_bucket(&by_ifindex, hash_int(r[i].dev->netdev->ifindex)));
+	if (rtnl_open(&rtnl, state->config.sysroot)) {
+		hash_table_free(&by_ifindex);
+		free(r);
+		return -1;
+	}
+
+	for (left=count; left; ) {
+		progress = 0;
+		for (i=0; i<count; i++) {
+			if (r[i].done)
+				continue;
+			holder = find_eth(state, r[i].dev->bios_name);
+			if (holder && find_rename(&by_ifindex, holder))
+				continue;	/* it moves first */
+			if (holder || rename_one(state, &rtnl, r[i].dev, r[i].dev->bios_name,
+						 renamed, arg)) {
+				if (holder)
+					fprintf(stderr, "Cannot rename %s to %s: %s keeps that name\n",
+						r[i].dev->netdev->kernel_name, r[i].dev->bios_name,
+						holder->kernel_name);
+				failed++;
+			}
+			r[i].done = 1;
+			left--;
+			progress = 1;
+		}
+		if (progress || !left)
+			continue;
+		/* only cycles are left; break one */
+		for (i=0; r[i].done; i++)
+			;
+		/* "bdn" and 8 hex digits fit IFNAMSIZ for any ifindex */
+		snprintf(tmp, sizeof(tmp), "bdn%x", (unsigned int)r[i].dev->netdev->ifindex);
+		if (find_eth(state, tmp) ||
+		    rename_one(state, &rtnl, r[i].dev, tmp, renamed, arg)) {
+			r[i].done = 1;
+			left--;
+			failed++;
+		}
+	}
+	rtnl_close(&rtnl);
+	hash_table_free(&by_ifindex);
+	free(r);
+	return failed;
+}
@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "runfiles.h"
+#include "io.h"
+
+void run_path(char *buf, int size, const char *sysroot, const char *name)
+{
+	snprintf(buf, size, "%s%s/%s", sysroot, RUN_DIR, name);
+}
+
+/* Make RUN_DIR, and name inside it when it's given */
+int run_mkdir(const char *sysroot, const char *name)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/run", sysroot);
+	if (mkdir(path, 0755) && errno != EEXIST)
+		return 1;
+	snprintf(path, sizeof(path), "%s%s", sysroot, RUN_DIR);
+	if (mkdir(path, 0755) && errno != EEXIST)
+		return 1;
+	if (!name)
+		return 0;
+	run_path(path, sizeof(path), sysroot, name);
+	if (mkdir(path, 0755) && errno != EEXIST)
+		return 1;
+	return 0;
+}
+
+int read_first_line(const char *path, char *buf, int size)
+{
+	FILE *fp;
+	int rc = 1;
+
+	fp = io_fopen(path, "r");
+	if (!fp)
+		return 1;
+	if (io_fgets(buf, size, fp) != NULL) {
+		buf[strcspn(buf, "\n")] = '\0';
+		rc = 0;
+	}
+	fclose(fp);
+	return rc;
+}
+
+/*
+ * Everything besides the hardware that names depend on, for this boot.
+ * config has its defaults filled in.  Returns 1 if the key doesn't fit,
+ * since a cut short key could match other options.
+ */
+int run_key(char *buf, int size, const struct libbiosdevname_config *config)
+{
+	char path[PATH_MAX], boot_id[64];
+	int len;
+
+	snprintf(path, sizeof(path), "%s/proc/sys/kernel/random/boot_id", config->sysroot);
+	if (read_first_line(path, boot_id, sizeof(boot_id)))
+		strcpy(boot_id, "-");
+	len = snprintf(buf, size, "%s %d %d %u.%u %s", boot_id, config->namingpolicy, config->nopirq,
+		       config->smver_mjr, config->smver_mnr, config->prefix);
+	return len < 0 || len >= size;
+}
+
+/* Write to tmp, next to path, until run_commit() renames it into place */
+FILE *run_create(const char *path, char *tmp, int size)
+{
+	snprintf(tmp, size, "%s.%d", path, (int)getpid());
+	return fopen(tmp, "w");
+}
+
+int run_commit(FILE *fp, const char *tmp, const char *path)
+{
+	if (fclose(fp) || rename(tmp, path)) {
+		unlink(tmp);
+		return 1;
+	}
+	return 0;
+}
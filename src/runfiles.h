@@ -0,0 +1,26 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef RUNFILES_H_INCLUDED
+#define RUNFILES_H_INCLUDED
+
+#include <stdio.h>
+#include "libbiosdevname.h"
+
+/*
+ * Results shared between biosdevname processes, under /run/biosdevname
+ * (inside the capture with --root).  Files are replaced by rename, so
+ * readers see either the old one or the new one.
+ */
+#define RUN_DIR "/run/biosdevname"
+
+extern void run_path(char *buf, int size, const char *sysroot, const char *name);
+extern int run_mkdir(const char *sysroot, const char *name);
+extern int run_key(char *buf, int size, const struct libbiosdevname_config *config);
+extern int read_first_line(const char *path, char *buf, int size);
+extern FILE *run_create(const char *path, char *tmp, int size);
+extern int run_commit(FILE *fp, const char *tmp, const char *path);
+
+#endif /* RUNFILES_H_INCLUDED */
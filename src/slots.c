@@ -0,0 +1,176 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * --slots lists which PCI slot each network and block device is in, with
+ * the port and partition a network device is named by, in one pass over
+ * what discovery already read.  It replaces pslots.sh.  Block devices
+ * take the slot of the closest PCI function above them in sysfs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "state.h"
+#include "pci.h"
+#include "libbiosdevname.h"
+#include "export.h"
+#include "slots.h"
+#include "io.h"
+
+struct slot_row {
+	const char *device;
+	const char *type;
+	const char *pci;
+	int slot;
+	int slot_source;
+	int port;
+	int pfi;
+	const char *driver;
+	const char *name;
+	const char *label;
+};
+
+static void print_number(int n)
+{
+	if (n >= 0)
+		printf(" %4d", n);
+	else
+		printf(" %4s", "-");
+}
+
+static void print_row(const struct slot_row *r)
+{
+	const char *source = slot_source_name(r->slot_source);
+
+	printf("%-12s %-5s %-13s", r->device, r->type, r->pci);
+	print_number(r->slot);
+	printf(" %-6s", source ? source : "-");
+	print_number(r->port);
+	print_number(r->pfi);
+	printf(" %-10s", r->driver);
+	if (r->label)
+		printf(" %-12s %s\n", r->name ? r->name : "-", r->label);
+	else
+		printf(" %s\n", r->name ? r->name : "-");
+}
+
+/* What the firmware calls the slot, or the device when it's embedded */
+static const char *slot_label(const struct pci_device *p)
+{
+	if (!p)
+		return NULL;
+	if (p->uses_smbios & HAS_SMBIOS_LABEL && p->smbios_label)
+		return p->smbios_label;
+	if (p->uses_sysfs & HAS_SYSFS_LABEL && p->sysfs_label)
+		return p->sysfs_label;
+	return NULL;
+}
+
+static void list_net_slots(struct libbiosdevname_state *state)
+{
+	const struct libbiosdevname_device *d;
+	struct slot_row r;
+
+	for (d = first_bios_device(state); d; d = next_bios_device(state, d)) {
+		if (!d->kernel_name)
+			continue;
+		r.device = d->kernel_name;
+		r.type = "net";
+		r.pci = d->bus_info[0] ? d->bus_info : "-";
+		r.slot = d->slot;
+		r.slot_source = d->slot_source;
+		r.port = d->port;
+		r.pfi = d->pfi;
+		r.driver = d->driver[0] ? d->driver : "-";
+		r.name = d->bios_name;
+		r.label = slot_label(find_slot_dev_by_pci_name(state, d->bus_info));
+		print_row(&r);
+	}
+}
+
+/*
+ * The closest PCI function above a block device.  Its /sys/block link
+ * already names every device above it, so it is read rather than
+ * resolved, and a capture's links can't lead outside it.
+ */
+static struct pci_device *block_pci_device(struct libbiosdevname_state *state, const char *name)
+{
+	char path[PATH_MAX], link[PATH_MAX];
+	struct pci_device *p = NULL, *d;
+	char *s, *save;
+	ssize_t len;
+
+	snprintf(path, sizeof(path), "%s/sys/block/%s", state->config.sysroot, name);
+	len = io_readlink(path, link, sizeof(link) - 1);
+	if (len < 0)
+		return NULL;
+	link[len] = '\0';
+	for (s = strtok_r(link, "/", &save); s; s = strtok_r(NULL, "/", &save)) {
+		d = find_dev_by_pci_name(state, s);
+		if (d)
+			p = d;
+	}
+	return p;
+}
+
+static void list_block_slots(struct libbiosdevname_state *state)
+{
+	char path[PATH_MAX], link[PATH_MAX], pci_name[16];
+	struct dirent **names;
+	struct pci_device *p;
+	struct slot_row r;
+	const char *s;
+	ssize_t len;
+	int i, n;
+
+	snprintf(path, sizeof(path), "%s/sys/block", state->config.sysroot);
+	n = io_scandir(path, &names, NULL, alphasort);
+	if (n < 0)
+		return;
+	for (i=0; i<n; i++) {
+		if (names[i]->d_name[0] == '.' ||
+		    (p = block_pci_device(state, names[i]->d_name)) == NULL) {
+			free(names[i]);
+			continue;
+		}
+		unparse_pci_name(pci_name, sizeof(pci_name), p->pci_dev);
+		snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/driver",
+			 state->config.sysroot, pci_name);
+		len = io_readlink(path, link, sizeof(link) - 1);
+		link[len > 0 ? len : 0] = '\0';
+		s = strrchr(link, '/');
+
+		r.device = names[i]->d_name;
+		r.type = "block";
+		r.pci = pci_name;
+		r.slot = pci_device_slot(state, p);
+		if (r.slot == PHYSICAL_SLOT_UNKNOWN)
+			r.slot = -1;
+		r.slot_source = p->slot_source;
+		r.port = -1;
+		r.pfi = -1;
+		r.driver = s ? s + 1 : "-";
+		r.name = NULL;
+		r.label = slot_label(p);
+		print_row(&r);
+		free(names[i]);
+	}
+	free(names);
+}
+
+int list_slots(void *cookie)
+{
+	struct libbiosdevname_state *state = cookie;
+
+	printf("%-12s %-5s %-13s %4s %-6s %4s %4s %-10s %-12s %s\n", "DEVICE", "TYPE", "PCI",
+	       "SLOT", "SOURCE", "PORT", "PFI", "DRIVER", "NAME", "LABEL");
+	list_net_slots(state);
+	list_block_slots(state);
+	return 0;
+}
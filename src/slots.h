@@ -0,0 +1,12 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef SLOTS_H_INCLUDED
+#define SLOTS_H_INCLUDED
+
+/* List the slot of every network and block device */
+extern int list_slots(void *cookie);
+
+#endif /* SLOTS_H_INCLUDED */
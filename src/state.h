@@ -8,15 +8,35 @@
 
 #include <pci/pci.h>
 #include "list.h"
+#include "hash.h"
 #include "pirq.h"
+#include "legacy_bios.h"
+#include "libbiosdevname.h"
 
 struct libbiosdevname_state {
 	struct list_head bios_devices;
+	struct hash_table bios_by_name;
+	struct hash_table bios_by_ifindex;
 	struct list_head pci_devices;
+	struct hash_table pci_by_addr;
+	struct hash_table vfs_by_addr;
 	struct list_head network_devices;
+	struct hash_table netdevs_by_bus_info;
+	struct hash_table netdevs_by_name;
+	unsigned int netdev_count;	/* entries in network_devices */
 	struct list_head slots;
 	struct pci_access *pacc;
-	struct routing_table *pirq_table;
+	char *pci_dump;
+	struct pirq_slot_map *pirq_map;
+	int pirq_loaded;
+	struct legacy_bios_area *bios_area;
+	int bios_area_scanned;
+	struct libbiosdevname_config config;	/* prefix and sysroot are never NULL */
+	int is_valid_smbios;		/* SMBIOS is at least config.smver */
+	int smbios_decoded;		/* dmidecode_main() has run */
+	int is_dell;			/* -1 until sys_vendor is read */
+	int rescan_domain;		/* -1, or the only bus SMBIOS may update */
+	int rescan_bus;
 };
 
 #endif /* LIBBIOSDEVICESTATE_H_INCLUDED */
@@ -5,6 +5,29 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "io.h"
+#include "sysfs.h"
+
+/*
+ * Format a path into buf.  Returns 0, or 1 with errno set to
+ * ENAMETOOLONG when it didn't fit, so a truncated path is never used.
+ */
+int sysfs_path(char *buf, size_t size, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(buf, size, fmt, ap);
+	va_end(ap);
+	if (len < 0 || (size_t)len >= size) {
+		errno = ENAMETOOLONG;
+		return 1;
+	}
+	return 0;
+}
 
 /**
  * sysfs_path_is_file: Check if the path supplied points to a file
@@ -43,13 +66,13 @@ int sysfs_read_file(const char * path, char **output)
 		return -ENOMEM;
 	memset(result, 0, resultsize);
 
-	fd = open(path, O_RDONLY);
+	fd = io_open(path, O_RDONLY);
 	if (fd < 0) {
 		ret = fd;
 		goto free_out;
 	}
 
-	length = read(fd, result, resultsize-1);
+	length = io_read(fd, result, resultsize-1);
 	close(fd);
 
 	if (length < 0) {
@@ -1,2 +1,13 @@
+#include <stddef.h>
+#include <limits.h>
+
+/*
+ * The longest sysroot accepted.  Every path read below it adds well
+ * under 1024 bytes, so with a sysroot this short none gets truncated.
+ */
+#define SYSROOT_MAX (PATH_MAX - 1024)
+
+extern int sysfs_path(char *buf, size_t size, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
 extern int sysfs_path_is_file(const char *path);
 extern int sysfs_read_file(const char *path, char **output);
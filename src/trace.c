@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+int trace_enabled;
+
+static FILE *trace_fp;
+static unsigned long long trace_start;
+static int trace_events;
+static int trace_pid;
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void put_string(const char *s)
+{
+	fputc('"', trace_fp);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(trace_fp, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(trace_fp, "\\u%04x", *s);
+		else
+			fputc(*s, trace_fp);
+	}
+	fputc('"', trace_fp);
+}
+
+/* Everything up to "ts", which is in microseconds since trace_open() */
+static void put_event(const char *ph, const char *cat, const char *name,
+		      unsigned long long ts)
+{
+	fprintf(trace_fp, "%s\n{\"ph\": \"%s\", \"pid\": %d, \"tid\": %d",
+		trace_events++ ? "," : "", ph, trace_pid, trace_pid);
+	if (cat) {
+		fprintf(trace_fp, ", \"cat\": ");
+		put_string(cat);
+	}
+	if (name) {
+		fprintf(trace_fp, ", \"name\": ");
+		put_string(name);
+	}
+	fprintf(trace_fp, ", \"ts\": %.3f", (ts - trace_start) / 1e3);
+}
+
+int trace_open(const char *path)
+{
+	trace_fp = fopen(path, "w");
+	if (!trace_fp)
+		return 1;
+	trace_pid = getpid();
+	trace_start = now();
+	trace_enabled = 1;
+	fprintf(trace_fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	put_event("M", NULL, "process_name", trace_start);
+	fprintf(trace_fp, ", \"args\": {\"name\": \"biosdevname\"}}");
+	return 0;
+}
+
+void trace_close(void)
+{
+	if (!trace_enabled)
+		return;
+	fprintf(trace_fp, "\n]}\n");
+	fclose(trace_fp);
+	trace_fp = NULL;
+	trace_enabled = 0;
+}
+
+/* 0 when not tracing, so callers can skip the clock */
+unsigned long long trace_now(void)
+{
+	return trace_enabled ? now() : 0;
+}
+
+void trace_begin(const char *cat, const char *name)
+{
+	if (!trace_enabled)
+		return;
+	put_event("B", cat, name, now());
+	fprintf(trace_fp, "}");
+}
+
+void trace_end(void)
+{
+	if (!trace_enabled)
+		return;
+	put_event("E", NULL, NULL, now());
+	fprintf(trace_fp, "}");
+}
+
+/* A complete event for one I/O call that started at start */
+void trace_io(const char *name, unsigned long long start,
+	      const char *path, long long bytes)
+{
+	if (!trace_enabled || !start)
+		return;
+	put_event("X", "io", name, start);
+	fprintf(trace_fp, ", \"dur\": %.3f", (now() - start) / 1e3);
+	if (path || bytes >= 0) {
+		fprintf(trace_fp, ", \"args\": {");
+		if (path) {
+			fprintf(trace_fp, "\"path\": ");
+			put_string(path);
+		}
+		if (bytes >= 0)
+			fprintf(trace_fp, "%s\"bytes\": %lld", path ? ", " : "", bytes);
+		fprintf(trace_fp, "}");
+	}
+	fprintf(trace_fp, "}");
+}
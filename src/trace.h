@@ -0,0 +1,23 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+/*
+ * Chrome trace event format ("traceEvents" JSON), as loaded by
+ * chrome://tracing and ui.perfetto.dev.  Process-wide, like profiling.
+ */
+extern int trace_enabled;
+
+extern int trace_open(const char *path);
+extern void trace_close(void);
+extern unsigned long long trace_now(void);
+extern void trace_begin(const char *cat, const char *name);
+extern void trace_end(void);
+extern void trace_io(const char *name, unsigned long long start,
+		     const char *path, long long bytes);
+
+#endif /* TRACE_H_INCLUDED */
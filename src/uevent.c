@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Kernel uevents for update_bios_devices(), either from netlink or,
+ * for replays against a --root tree, as text.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "libbiosdevname.h"
+#include "uevent.h"
+
+int uevent_open(void)
+{
+	struct sockaddr_nl addr;
+	int fd, size = 1024*1024;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+	if (fd < 0)
+		return -1;
+	/* a VF burst is hundreds of events; losing one means starting over */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1;	/* the kernel's, not udev's */
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Returns the length of the next kernel uevent, or -1 with errno set.
+ * ENOBUFS means events were lost and the state has to be set up again.
+ */
+ssize_t uevent_recv(int fd, char *buf, size_t size)
+{
+	struct sockaddr_nl addr;
+	struct msghdr msg;
+	struct iovec iov;
+	ssize_t len;
+
+	for (;;) {
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = buf;
+		iov.iov_len = size - 1;
+		msg.msg_name = &addr;
+		msg.msg_namelen = sizeof(addr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		len = recvmsg(fd, &msg, 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		/* only the kernel may send to group 1 */
+		if (addr.nl_pid != 0 || msg.msg_flags & MSG_TRUNC)
+			continue;
+		buf[len] = '\0';
+		return len;
+	}
+}
+
+/*
+ * Read one event written as KEY=value lines and ended by a blank line
+ * or EOF, in the netlink format.  Returns -1 at EOF.
+ */
+ssize_t uevent_read_text(FILE *fp, char *buf, size_t size)
+{
+	char line[4096];
+	size_t len = 0, n;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		n = strcspn(line, "\r\n");
+		line[n] = '\0';
+		if (!n) {
+			if (len)
+				return len;
+			continue;
+		}
+		if (!strchr(line, '=') || len + n + 1 >= size)
+			continue;
+		memcpy(buf + len, line, n + 1);
+		len += n + 1;
+	}
+	return len ? (ssize_t)len : -1;
+}
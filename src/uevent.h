@@ -0,0 +1,16 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef UEVENT_H_INCLUDED
+#define UEVENT_H_INCLUDED
+
+#include <stdio.h>
+#include <sys/types.h>
+
+extern int uevent_open(void);
+extern ssize_t uevent_recv(int fd, char *buf, size_t size);
+extern ssize_t uevent_read_text(FILE *fp, char *buf, size_t size);
+
+#endif /* UEVENT_H_INCLUDED */
@@ -0,0 +1,267 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+
+/*
+ * Writing N to sriov_numvfs adds N interfaces, and udev asks about each
+ * of them.  Their names differ only in the VF index, so the first one
+ * to be named names all of its PF's VFs and saves them, and the rest
+ * are answered from that file without scanning PCI or SMBIOS again.
+ *
+ * A saved name is only used in the same boot, with the same options,
+ * while the PF has the same number of VFs, and for an interface that
+ * use_physical() would have named from its VF alone: the only one on
+ * its VF, from a driver that isn't multiport.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <net/if.h>
+#include "bios_device.h"
+#include "state.h"
+#include "libbiosdevname.h"
+#include "naming_policy.h"
+#include "io.h"
+#include "runfiles.h"
+#include "profile.h"
+#include "vfcache.h"
+
+#define VF_CACHE_MAGIC "biosdevname-vfs 1"
+
+/* A PCI name that doesn't fit in buf would match the wrong function */
+static int read_link_name(const char *path, char *buf, int size)
+{
+	char link[PATH_MAX], *base;
+	ssize_t len;
+	int n;
+
+	len = io_readlink(path, link, sizeof(link)-1);
+	if (len < 0)
+		return 1;
+	link[len] = '\0';
+	base = strrchr(link, '/');
+	n = snprintf(buf, size, "%s", base ? base+1 : link);
+	return n < 0 || n >= size;
+}
+
+static void cache_path(char *buf, int size, const char *sysroot, const char *pf_name)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), "vfs/%s", pf_name);
+	run_path(buf, size, sysroot, name);
+}
+
+/* Same boot and options, same number of VFs.  Returns 1 if it doesn't fit. */
+static int cache_key(char *buf, int size, const struct libbiosdevname_config *config,
+		     const char *numvfs)
+{
+	char key[256];
+	int n;
+
+	if (run_key(key, sizeof(key), config))
+		return 1;
+	n = snprintf(buf, size, "%s %s", key, numvfs);
+	return n < 0 || n >= size;
+}
+
+/*
+ * ethN follows every interface, and a "p" prefix can mimic slot names.
+ * config has its defaults filled in.
+ */
+static int cacheable(const struct libbiosdevname_config *config)
+{
+	return config->namingpolicy == physical && config->prefix[0] != 'p';
+}
+
+static int read_numvfs(const char *sysroot, const char *pf_name, char *buf, int size)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/sriov_numvfs", sysroot, pf_name);
+	return read_first_line(path, buf, size);
+}
+
+static int count_pci_eths(const char *sysroot, const char *pci_name)
+{
+	char path[PATH_MAX];
+	struct dirent **namelist;
+	int i, n, count = 0;
+
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/net", sysroot, pci_name);
+	n = io_scandir(path, &namelist, NULL, NULL);
+	if (n < 0)
+		return 0;
+	for (i=0; i<n; i++) {
+		if (namelist[i]->d_name[0] != '.')
+			count++;
+		free(namelist[i]);
+	}
+	free(namelist);
+	return count;
+}
+
+/* state is empty, and only there to read devname into */
+static char *lookup(struct libbiosdevname_state *state, const char *devname)
+{
+	const char *sysroot = state->config.sysroot;
+	struct network_device *n;
+	char vf_name[40], pf_name[40], numvfs[16], path[PATH_MAX];
+	char key[256], line[256], name[IFNAMSIZ];
+	char *result = NULL;
+	size_t len;
+	FILE *fp;
+
+	if (read_eth_pci_name(sysroot, devname, vf_name, sizeof(vf_name)))
+		return NULL;
+	snprintf(path, sizeof(path), "%s/sys/bus/pci/devices/%s/physfn", sysroot, vf_name);
+	if (read_link_name(path, pf_name, sizeof(pf_name)) ||
+	    read_numvfs(sysroot, pf_name, numvfs, sizeof(numvfs)))
+		return NULL;
+	if (cache_key(key, sizeof(key), &state->config, numvfs))
+		return NULL;
+	cache_path(path, sizeof(path), sysroot, pf_name);
+	fp = io_fopen(path, "r");
+	if (!fp)
+		return NULL;
+	if (io_fgets(line, sizeof(line), fp) == NULL ||
+	    strcmp(line, VF_CACHE_MAGIC "\n") ||
+	    io_fgets(line, sizeof(line), fp) == NULL ||
+	    strncmp(line, key, strlen(key)) || line[strlen(key)] != '\n') {
+		fclose(fp);
+		return NULL;
+	}
+	len = strlen(vf_name);
+	while (io_fgets(line, sizeof(line), fp) != NULL) {
+		if (!strncmp(line, vf_name, len) && line[len] == ' ' &&
+		    sscanf(line + len, " %15s", name) == 1) {
+			result = name;
+			break;
+		}
+	}
+	fclose(fp);
+	if (!result || count_pci_eths(sysroot, vf_name) != 1)
+		return NULL;
+
+	/* the interface itself still has to be one that match_all() takes */
+	n = get_eth(state, devname);
+	if (n && is_pci_eth(n, vf_name) && !ismultiport(n->drvinfo.driver))
+		return strdup(name);
+	return NULL;
+}
+
+/* Returns the saved name of devname, or NULL to name it the usual way */
+char * vf_cache_lookup(const struct libbiosdevname_config *config, const char *devname)
+{
+	struct libbiosdevname_state *state;
+	char *result;
+
+	state = alloc_state(config);
+	if (!state)
+		return NULL;
+	if (!cacheable(&state->config)) {
+		cleanup_bios_devices(state);
+		return NULL;
+	}
+	profile_begin(PROFILE_VF_CACHE);
+	result = lookup(state, devname);
+	profile_end(PROFILE_VF_CACHE);
+	cleanup_bios_devices(state);
+	return result;
+}
+
+static int clashes(const struct libbiosdevname_state *state, const struct pci_device *vf,
+		   const char *name)
+{
+	struct bios_device *dev;
+
+	list_for_each_entry(dev, &state->bios_devices, node) {
+		if (dev->pcidev != vf && dev->bios_name && !strcmp(dev->bios_name, name))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Save the names of all the VFs of devname's PF, once devname has been
+ * named from a state that read at least every interface in its slot.
+ */
+void vf_cache_publish(void *cookie, const char *devname)
+{
+	struct libbiosdevname_state *state = cookie;
+	struct bios_device *b, tmp;
+	struct pci_device *pf, vf;
+	struct pci_sriov *sriov;
+	char pf_name[40], numvfs[16], path[PATH_MAX], newpath[PATH_MAX];
+	char key[256];
+	char **names, *dup;
+	unsigned int i, j;
+	FILE *fp;
+
+	if (!state || !cacheable(&state->config))
+		return;
+	b = find_bios_device_by_name(state, devname);
+	if (!b || !b->pcidev || !b->pcidev->is_sriov_virtual_function ||
+	    b->port || !b->bios_name || b->duplicate)
+		return;
+	pf = b->pcidev->pf;
+	sriov = pf->sriov;
+	unparse_pci_name(pf_name, sizeof(pf_name), pf->pci_dev);
+	if (read_numvfs(state->config.sysroot, pf_name, numvfs, sizeof(numvfs)) ||
+	    strtoul(numvfs, NULL, 10) != sriov->num_vfs)
+		return;
+
+	names = calloc(sriov->num_vfs, sizeof(*names));
+	dup = calloc(sriov->num_vfs, 1);
+	if (!names || !dup)
+		goto out;
+	/* in a burst, later VFs may not even be in sysfs yet */
+	for (i=0; i<sriov->num_vfs; i++) {
+		if (sriov->vf[i].domain < 0)
+			continue;
+		/* a VF that isn't in sysfs can only take its slot from SMBIOS */
+		if (!sriov->vf[i].pci_dev && !pf->smbios_enabled)
+			continue;
+		init_vf_device(state, &vf, &sriov->vf[i]);
+		memset(&tmp, 0, sizeof(tmp));
+		tmp.pcidev = &vf;
+		name_physical(&tmp, state->config.prefix);
+		free(vf.smbios_label);
+		names[i] = tmp.bios_name;
+		if (names[i] && clashes(state, sriov->vf[i].dev, names[i])) {
+			free(names[i]);
+			names[i] = NULL;
+		}
+	}
+	/* a name two VFs would share is left for the full run to mark */
+	for (i=0; i<sriov->num_vfs; i++) {
+		for (j=0; names[i] && j<sriov->num_vfs; j++) {
+			if (j != i && names[j] && !strcmp(names[i], names[j]))
+				dup[i] = 1;
+		}
+	}
+
+	if (cache_key(key, sizeof(key), &state->config, numvfs) ||
+	    run_mkdir(state->config.sysroot, "vfs"))
+		goto out;
+	cache_path(path, sizeof(path), state->config.sysroot, pf_name);
+	fp = run_create(path, newpath, sizeof(newpath));
+	if (!fp)
+		goto out;
+	fprintf(fp, "%s\n%s\n", VF_CACHE_MAGIC, key);
+	for (i=0; i<sriov->num_vfs; i++) {
+		if (!names[i] || dup[i])
+			continue;
+		fprintf(fp, "%04x:%02x:%02x.%x %s\n", sriov->vf[i].domain, sriov->vf[i].bus,
+			sriov->vf[i].device, sriov->vf[i].func, names[i]);
+	}
+	run_commit(fp, newpath, path);
+out:
+	for (i=0; names && i<sriov->num_vfs; i++)
+		free(names[i]);
+	free(names);
+	free(dup);
+}
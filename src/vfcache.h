@@ -0,0 +1,14 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef VFCACHE_H_INCLUDED
+#define VFCACHE_H_INCLUDED
+
+#include "libbiosdevname.h"
+
+extern char * vf_cache_lookup(const struct libbiosdevname_config *config, const char *devname);
+extern void vf_cache_publish(void *cookie, const char *devname);
+
+#endif /* VFCACHE_H_INCLUDED */
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "vpd.h"
+#include "io.h"
+
+/*
+ * VPD comes straight from adapter firmware, so nothing here trusts a
+ * length field further than the buffer it was read into.
+ */
+
+static inline u16 pci_vpd_lrdt_size(const u8 *lrdt)
+{
+	return (u16)lrdt[0] + ((u16)lrdt[1] << 8L);
+}
+
+static inline u8 pci_vpd_srdt_size(const u8* srdt)
+{
+	return (*srdt) & PCI_VPD_SRDT_LEN_MASK;
+}
+
+int pci_vpd_readtag(int fd, int *len)
+{
+	u8 tag, tlen[2];
+
+	if (io_read(fd, &tag, 1) != 1)
+		return -1;
+	if (tag == 0x00 || tag == 0xFF || tag == 0x7F)
+		return -1;
+	if (tag & PCI_VPD_LRDT) {
+		if (io_read(fd, tlen, 2) != 2)
+			return -1;
+		*len = pci_vpd_lrdt_size(tlen);
+		/* Check length of VPD-R */
+		if (*len  >= PCI_VPDR_MAX_LEN)
+			return -1;
+		return tag;
+	}
+	*len = pci_vpd_srdt_size(&tag);
+	return (tag & ~0x7);
+}
+
+/* Skip the identifier string and read the VPD-R section into buf */
+int pci_vpd_read_vpdr(int fd, u8 *buf, int size)
+{
+	int len;
+
+	if (pci_vpd_readtag(fd, &len) != PCI_VPDI_TAG)
+		return -1;
+	if (lseek(fd, len, SEEK_CUR) < 0)
+		return -1;
+	if (pci_vpd_readtag(fd, &len) != PCI_VPDR_TAG || len > size)
+		return -1;
+	if (io_read(fd, buf, len) != len)
+		return -1;
+	return len;
+}
+
+const struct vpd_tag *pci_vpd_findtag(const void *buf, int len, const char *sig)
+{
+	const struct vpd_tag *t;
+	int off, siglen;
+
+	off = 0;
+	siglen = strlen(sig);
+	while (off + PCI_VPD_INFO_FLD_HDR_SIZE <= len) {
+		t = (const struct vpd_tag *)((const u8 *)buf + off);
+		/* a keyword running off the end means the rest is garbage */
+		if (off + PCI_VPD_INFO_FLD_HDR_SIZE + t->len > len)
+			return NULL;
+		if (t->len >= siglen && !memcmp(t->data, sig, siglen))
+			return t;
+		off += t->len + PCI_VPD_INFO_FLD_HDR_SIZE;
+	}
+	return NULL;
+}
+
+/*
+ * Walk the Dell DCM (or DC2) port map, calling fn for each entry.
+ * Returns the number of entries found.
+ */
+int pci_vpd_parse_dcm(const void *vpd, int len, vpd_dcm_fn fn, void *arg)
+{
+	const struct vpd_tag *dcm;
+	const char *fmt;
+	char entry[12];
+	int i, n, port, devfn, pfi, step;
+
+	fmt = "%1x%1x%2x";
+	step = 10;
+	dcm = pci_vpd_findtag(vpd, len, "DCM");
+	if (dcm == NULL) {
+		dcm = pci_vpd_findtag(vpd, len, "DC2");
+		if (dcm == NULL)
+			return 0;
+		fmt = "%1x%2x%2x";
+		step = 11;
+	}
+	/* a truncated last entry is ignored */
+	for (i = 3, n = 0; i + step <= dcm->len; i += step, n++) {
+		/* the keyword data isn't NUL terminated */
+		memcpy(entry, dcm->data+i, step);
+		entry[step] = '\0';
+		if (sscanf(entry, fmt, &port, &devfn, &pfi) != 3)
+			break;
+		fn(arg, port, devfn, pfi);
+	}
+	return n;
+}
@@ -0,0 +1,39 @@
+/*
+ *  Copyright (c) 2006 Dell, Inc.
+ *  by Matt Domsch <Matt_Domsch@dell.com>
+ *  Licensed under the GNU General Public license, version 2.
+ */
+#ifndef VPD_H_INCLUDED
+#define VPD_H_INCLUDED
+
+#include <pci/pci.h>
+
+/* Borrowed from kernel vpd code */
+#define PCI_VPD_LRDT			0x80
+#define PCI_VPD_SRDT_END		0x78
+#define PCI_VPDI_TAG			0x82
+#define PCI_VPDR_TAG			0x90
+
+#define PCI_VPD_SRDT_LEN_MASK		0x7
+#define PCI_VPD_LRDT_TAG_SIZE		3
+#define PCI_VPD_SRDT_TAG_SIZE		1
+#define PCI_VPD_INFO_FLD_HDR_SIZE	3
+
+/* VPD-R larger than this is treated as garbage */
+#define PCI_VPDR_MAX_LEN		1024
+
+struct vpd_tag
+{
+	char	cc[2];
+	u8	len;
+	char	data[1];
+};
+
+typedef void (*vpd_dcm_fn)(void *arg, int port, int devfn, int pfi);
+
+extern int pci_vpd_readtag(int fd, int *len);
+extern int pci_vpd_read_vpdr(int fd, u8 *buf, int size);
+extern const struct vpd_tag *pci_vpd_findtag(const void *buf, int len, const char *sig);
+extern int pci_vpd_parse_dcm(const void *vpd, int len, vpd_dcm_fn fn, void *arg);
+
+#endif /* VPD_H_INCLUDED */